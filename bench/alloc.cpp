@@ -0,0 +1,87 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "alloctrack.h"
+#include "bench.h"
+
+// Every heap allocation in the bench binary goes through here and is
+// counted, so each benchmark can report allocations per op. The counters
+// are relaxed atomics: one uncontended add per allocation. With
+// WITNESS_ALLOC_TRACKING the core library counts instead.
+
+#ifdef WITNESS_ALLOC_TRACKING
+
+AllocCount AllocsSoFar() {
+  AllocStats a = AllocTotals();
+  return {a.allocs, a.bytes};
+}
+
+#else
+
+namespace {
+
+std::atomic<int64_t> allocs(0);
+std::atomic<int64_t> bytes(0);
+
+void *Count(size_t n, size_t align) {
+  allocs.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(n, std::memory_order_relaxed);
+  if (n == 0)
+    n = 1;
+  void *p;
+  if (align <= alignof(std::max_align_t))
+    p = std::malloc(n);
+  else
+    p = std::aligned_alloc(align, (n + align - 1) / align * align);
+  return p;
+}
+
+} // namespace
+
+AllocCount AllocsSoFar() {
+  return {allocs.load(std::memory_order_relaxed),
+          bytes.load(std::memory_order_relaxed)};
+}
+
+void *operator new(size_t n) {
+  if (void *p = Count(n, 0))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t n) { return operator new(n); }
+
+void *operator new(size_t n, std::align_val_t a) {
+  if (void *p = Count(n, (size_t)a))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t n, std::align_val_t a) {
+  return operator new(n, a);
+}
+
+void *operator new(size_t n, const std::nothrow_t &) noexcept {
+  return Count(n, 0);
+}
+
+void *operator new[](size_t n, const std::nothrow_t &) noexcept {
+  return Count(n, 0);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Heap allocations by every thread since the program started, counted by
+// the operator new in alloc.cpp.
+struct AllocCount {
+  int64_t allocs;
+  int64_t bytes;
+};
+
+AllocCount AllocsSoFar();
+
+/**
+ * @class BenchState
+ * @brief Iteration state handed to a benchmark body
+ *
+ * The body times its loop with
+ * `for ([[maybe_unused]] auto _ : state) { ... }`. The runner grows the
+ * iteration count until one run takes long enough to measure.
+ */
+class BenchState {
+public:
+  int64_t iterations_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point stop_;
+  AllocCount startallocs_;
+  AllocCount stopallocs_;
+  string label_;
+  int64_t items_;     // what the body reported doing, see SetItemsProcessed
+  const char *unit_;
+
+  BenchState(int64_t n)
+      : iterations_(n), startallocs_{0, 0}, stopallocs_{0, 0}, items_(0),
+        unit_(nullptr) {}
+
+  struct Iterator {
+    BenchState *state;
+    int64_t left;
+    bool operator!=(const Iterator &) {
+      if (left > 0)
+        return true;
+      state->stop_ = std::chrono::steady_clock::now();
+      state->stopallocs_ = AllocsSoFar();
+      return false;
+    }
+    void operator++() { left--; }
+    int operator*() const { return 0; }
+  };
+
+  Iterator begin() {
+    startallocs_ = AllocsSoFar();
+    start_ = std::chrono::steady_clock::now();
+    return {this, iterations_};
+  }
+  Iterator end() { return {this, 0}; }
+
+  int64_t iterations() const { return iterations_; }
+
+  double Seconds() const {
+    return std::chrono::duration<double>(stop_ - start_).count();
+  }
+
+  double Allocs() const {
+    return double(stopallocs_.allocs - startallocs_.allocs) / iterations_;
+  }
+
+  double AllocBytes() const {
+    return double(stopallocs_.bytes - startallocs_.bytes) / iterations_;
+  }
+
+  void SetLabel(const string &s) { label_ = s; }
+
+  /** @brief Report n things done in the timed loop, printed as unit/s */
+  void SetItemsProcessed(int64_t n, const char *unit) {
+    items_ = n;
+    unit_ = unit;
+  }
+};
+
+struct Benchmark {
+  string name;
+  std::function<void(BenchState &)> fn;
+};
+
+inline vector<Benchmark> &Benchmarks() {
+  static vector<Benchmark> all;
+  return all;
+}
+
+struct BenchRegistrar {
+  BenchRegistrar(const char *name, std::function<void(BenchState &)> fn) {
+    Benchmarks().push_back({name, fn});
+  }
+};
+
+#define BENCHMARK(fn) static BenchRegistrar bench_registrar_##fn(#fn, fn)
+
+// Keep the compiler from discarding a value computed only for timing.
+template <typename T> inline void DoNotOptimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
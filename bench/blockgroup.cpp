@@ -0,0 +1,208 @@
+#include <map>
+
+#include "bench.h"
+#include "panels.h"
+
+// BlockGroup::solve on the regions IsValid hands it: the old search (dfsUtil
+// on sets), then the placement masks searched in piece order and as an exact
+// cover.
+
+namespace {
+
+struct Tiling {
+  BlockGroup region;
+  vector<BlockGroup> pieces;
+};
+
+// Every region holding a block, in every solved block panel, plus each whole
+// unsolved panel (the kind of region the prune asks about early on).
+const vector<Tiling> &Tilings() {
+  static vector<Tiling> res;
+  if (!res.empty())
+    return res;
+
+  for (auto g : Panels(kChallengeBlocks)) {
+    for (int solved = 0; solved < 2; solved++) {
+      Grid grid = g;
+      if (solved) {
+        Solver s(g);
+        s.seed_ = 1;
+        if (s.Solve().empty())
+          continue;
+        s.Activate();
+        grid = s.grid_;
+      }
+      Regions regions;
+      regions.LabelLattice(grid.m_, grid.n_, grid.occupied_);
+      for (int r = 0; r < regions.count_; r++) {
+        vector<pair<int, int>> cells;
+        vector<BlockGroup> pieces;
+        for (const int *k = regions.Begin(r); k != regions.End(r); k++) {
+          int i = *k / grid.n_, j = *k % grid.n_;
+          cells.push_back(make_pair(j >> 1, -1 * i >> 1));
+          BlockGroup *bg = symbol_cast<BlockGroup>(grid.board_[i][j]);
+          if (bg != nullptr)
+            pieces.push_back(*bg);
+        }
+        if (!pieces.empty())
+          res.push_back({BlockGroup(1, 0, cells), pieces});
+      }
+    }
+  }
+  return res;
+}
+
+// A side x side board cut into count random pieces, added to res once as cut
+// (tileable) and once with a corner cell moved off the board (tileable only
+// if a single-cell piece can fill it). Every piece may rotate.
+void Cut(mt19937 &rng, int side, int count, vector<Tiling> &res) {
+  // Grow the pieces from random seeds, one cell at a time.
+  vector<int> owner(side * side, -1);
+  vector<vector<pair<int, int>>> cells(count);
+  for (int p = 0; p < count; p++) {
+    int k;
+    do
+      k = rng() % (side * side);
+    while (owner[k] >= 0);
+    owner[k] = p;
+    cells[p].push_back({k / side, k % side});
+  }
+  for (int left = side * side - count; left > 0;) {
+    int p = rng() % count;
+    auto c = cells[p][rng() % cells[p].size()];
+    int d = rng() % 4;
+    int x = c.first + (d == 0) - (d == 1), y = c.second + (d == 2) - (d == 3);
+    if (x < 0 || y < 0 || x >= side || y >= side || owner[x * side + y] >= 0)
+      continue;
+    owner[x * side + y] = p;
+    cells[p].push_back({x, y});
+    left--;
+  }
+
+  vector<BlockGroup> pieces;
+  for (auto &c : cells)
+    pieces.push_back(BlockGroup(false, false, c));
+  vector<pair<int, int>> board, notched;
+  for (int k = 0; k < side * side; k++)
+    board.push_back({k / side, k % side});
+  notched = board;
+  notched.back() = {-1, -1};
+  res.push_back({BlockGroup(1, 0, board), pieces});
+  res.push_back({BlockGroup(1, 0, notched), pieces});
+}
+
+// Bigger puzzles than the game makes: a 6x6 board cut into 6 to 9 pieces.
+const vector<Tiling> &Crowded() {
+  static vector<Tiling> res;
+  if (!res.empty())
+    return res;
+
+  mt19937 rng(4242);
+  while (res.size() < 32) {
+    int count = 6 + rng() % 4;
+    Cut(rng, 6, count, res);
+  }
+  return res;
+}
+
+// Boards cut into exactly count pieces: 4x4 (the game's panel) up to four
+// pieces, 6x6 beyond.
+const vector<Tiling> &Pieces(int count) {
+  static std::map<int, vector<Tiling>> all;
+  vector<Tiling> &res = all[count];
+  if (!res.empty())
+    return res;
+
+  mt19937 rng(4242 + count);
+  while (res.size() < 32)
+    Cut(rng, count <= 4 ? 4 : 6, count, res);
+  return res;
+}
+
+// BlockGroup::solve as it was before the placement masks.
+bool SolveDfs(Tiling &t) {
+  int diff = t.region.n;
+  for (auto &i : t.pieces)
+    diff += i.sub ? i.n : -i.n;
+  return diff == 0 && t.region.dfsUtil(t.region.clone(), t.pieces, 0);
+}
+
+template <int Method>
+void TileRegions(BenchState &state, const vector<Tiling> &all) {
+  vector<Tiling> tilings = all;
+  size_t i = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    Tiling &t = tilings[i];
+    switch (Method) {
+    case 0:
+      DoNotOptimize(SolveDfs(t));
+      break;
+    case 1:
+      DoNotOptimize(t.region.solve(t.pieces, Tiler::kBacktrack));
+      break;
+    case 2:
+      DoNotOptimize(t.region.solve(t.pieces, Tiler::kExactCover));
+      break;
+    }
+    if (++i == tilings.size())
+      i = 0;
+  }
+  int tileable = 0;
+  for (auto &t : tilings)
+    tileable += t.region.solve(t.pieces);
+  state.SetLabel(to_string(tilings.size()) + " regions, " +
+                 to_string(tileable) + " tileable");
+}
+
+void BM_TileDfs(BenchState &state) { TileRegions<0>(state, Tilings()); }
+
+void BM_TileMasks(BenchState &state) { TileRegions<1>(state, Tilings()); }
+
+void BM_TileCover(BenchState &state) { TileRegions<2>(state, Tilings()); }
+
+// Every region after the first round is a hit: the cost of the key and the
+// lookup.
+void BM_TileCached(BenchState &state) {
+  vector<Tiling> tilings = Tilings();
+  TileCache cache(TileCache::kCapacity);
+  size_t i = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    Tiling &t = tilings[i];
+    DoNotOptimize(cache.Solve(t.region, t.pieces, Tiler::kExactCover));
+    if (++i == tilings.size())
+      i = 0;
+  }
+  state.SetLabel(to_string(cache.Hits()) + " hits, " +
+                 to_string(cache.Misses()) + " misses");
+}
+
+void BM_TileCrowdedMasks(BenchState &state) {
+  TileRegions<1>(state, Crowded());
+}
+
+void BM_TileCrowdedCover(BenchState &state) {
+  TileRegions<2>(state, Crowded());
+}
+
+// The default tiler by piece count.
+void BM_TilePieces1(BenchState &state) { TileRegions<2>(state, Pieces(1)); }
+void BM_TilePieces2(BenchState &state) { TileRegions<2>(state, Pieces(2)); }
+void BM_TilePieces3(BenchState &state) { TileRegions<2>(state, Pieces(3)); }
+void BM_TilePieces4(BenchState &state) { TileRegions<2>(state, Pieces(4)); }
+void BM_TilePieces6(BenchState &state) { TileRegions<2>(state, Pieces(6)); }
+void BM_TilePieces8(BenchState &state) { TileRegions<2>(state, Pieces(8)); }
+
+} // namespace
+
+BENCHMARK(BM_TileDfs);
+BENCHMARK(BM_TileMasks);
+BENCHMARK(BM_TileCover);
+BENCHMARK(BM_TileCached);
+BENCHMARK(BM_TileCrowdedMasks);
+BENCHMARK(BM_TileCrowdedCover);
+BENCHMARK(BM_TilePieces1);
+BENCHMARK(BM_TilePieces2);
+BENCHMARK(BM_TilePieces3);
+BENCHMARK(BM_TilePieces4);
+BENCHMARK(BM_TilePieces6);
+BENCHMARK(BM_TilePieces8);
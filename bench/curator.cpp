@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <thread>
+
+#include "bench.h"
+#include "curator.h"
+#include "panels.h"
+
+// The curation pipeline end to end: generate, solve, count solutions and
+// filter, reported as panels kept per second.
+
+namespace {
+
+void Curate(BenchState &state, PuzzleFamily family, int threads,
+            const Filter &filter) {
+  Curator c(threads, 12345);
+  long long kept = 0, generated = 0;
+  std::streambuf *old = cout.rdbuf(nullptr); // the generators are chatty
+  for ([[maybe_unused]] auto _ : state) {
+    kept += c.Make(family, 16, filter, 1 << 12).size();
+    generated += c.generated_;
+  }
+  cout.rdbuf(old);
+  char label[64];
+  snprintf(label, sizeof label, "%.1f puzzles/s, %lld%% kept",
+           kept / state.Seconds(), generated ? 100 * kept / generated : 0);
+  state.SetLabel(label);
+}
+
+int Cores() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// At most n solutions. Triangle panels mostly come out unique, block
+// panels often have a handful of solutions, and dot and star panels
+// hundreds, so only the first two are worth filtering this way.
+Filter AtMost(long long n) {
+  Filter f;
+  f.maxsolutions = n;
+  return f;
+}
+
+void BM_CurateChallengeBlocks(BenchState &state) {
+  Curate(state, kChallengeBlocks, 1, Filter());
+}
+void BM_CurateChallengeBlocksParallel(BenchState &state) {
+  Curate(state, kChallengeBlocks, Cores(), Filter());
+}
+void BM_CurateChallengeBlocksFew(BenchState &state) {
+  Curate(state, kChallengeBlocks, 1, AtMost(4));
+}
+void BM_CurateTrianglesUnique(BenchState &state) {
+  Curate(state, kTriangles, 1, AtMost(1));
+}
+void BM_CurateTrianglesUniqueParallel(BenchState &state) {
+  Curate(state, kTriangles, Cores(), AtMost(1));
+}
+
+} // namespace
+
+BENCHMARK(BM_CurateChallengeBlocks);
+BENCHMARK(BM_CurateChallengeBlocksParallel);
+BENCHMARK(BM_CurateChallengeBlocksFew);
+BENCHMARK(BM_CurateTrianglesUnique);
+BENCHMARK(BM_CurateTrianglesUniqueParallel);
@@ -0,0 +1,98 @@
+#include <filesystem>
+
+#include "bench.h"
+#include "gridtext.h"
+#include "panels.h"
+
+// The text format: writing and parsing a corpus of 100k panels, and
+// ToString for comparison.
+
+namespace {
+
+const size_t kTextPanels = 100000;
+
+string TextPath(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// The bench panels of every family.
+const vector<Grid> &AllPanels() {
+  static vector<Grid> all;
+  if (all.empty())
+    for (int fam = 0; fam < kPuzzleFamilies; fam++)
+      for (auto &g : Panels((PuzzleFamily)fam))
+        all.push_back(g);
+  return all;
+}
+
+// AllPanels over and over until the file holds count of them.
+void WriteText(const string &path, size_t count) {
+  const vector<Grid> &all = AllPanels();
+  GridTextWriter w;
+  w.Open(path);
+  for (size_t i = 0; i < count; i++)
+    w.Write(all[i % all.size()]);
+  w.Close();
+}
+
+const string &BigText() {
+  static string path;
+  if (path.empty()) {
+    path = TextPath("witness_bench.txt");
+    WriteText(path, kTextPanels);
+  }
+  return path;
+}
+
+string Rate(double panels, double bytes, double seconds) {
+  return to_string((long long)(panels / seconds)) + " panels/s, " +
+         to_string((long long)(bytes / seconds / 1e6)) + " MB/s";
+}
+
+void BM_TextWrite(BenchState &state) {
+  string path = TextPath("witness_bench_write.txt");
+  AllPanels();
+  auto t0 = std::chrono::steady_clock::now();
+  size_t ops = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    WriteText(path, kTextPanels);
+    ops++;
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+                 .count();
+  double bytes = std::filesystem::file_size(path);
+  std::filesystem::remove(path);
+  state.SetLabel(Rate(ops * kTextPanels, ops * bytes, s));
+}
+
+void BM_TextParse(BenchState &state) {
+  const string &path = BigText();
+  auto t0 = std::chrono::steady_clock::now();
+  size_t ops = 0, bytes = 0, panels = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    GridTextReader r;
+    r.Open(path);
+    Grid g;
+    while (r.Next(g))
+      panels++;
+    bytes += r.Size();
+    ops++;
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+                 .count();
+  state.SetLabel(Rate(panels, bytes, s));
+}
+
+// One panel, in the lossy debug form.
+void BM_ToString(BenchState &state) {
+  const vector<Grid> &all = AllPanels();
+  size_t i = 0;
+  for ([[maybe_unused]] auto _ : state)
+    DoNotOptimize(all[i++ % all.size()].ToString().size());
+}
+
+} // namespace
+
+BENCHMARK(BM_TextWrite);
+BENCHMARK(BM_TextParse);
+BENCHMARK(BM_ToString);
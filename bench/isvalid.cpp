@@ -0,0 +1,194 @@
+#include <iostream>
+#include <memory>
+
+#include "bench.h"
+#include "panels.h"
+
+// IsValid on solved panels, over every family and for each family alone,
+// ValidateRegion on the open regions beside partial lines, and the per-cell
+// type dispatch they are built on.
+
+namespace {
+
+struct Solved {
+  Grid grid;
+  pair<int, int> start;
+  PuzzleFamily family;
+};
+
+// Every panel of every family, solved.
+const vector<Solved> &SolvedGrids() {
+  static vector<Solved> res;
+  if (!res.empty())
+    return res;
+
+  for (int fam = 0; fam < kPuzzleFamilies; fam++) {
+    for (auto g : Panels(PuzzleFamily(fam))) {
+      Solver s(g);
+      s.seed_ = 1;
+      auto sol = s.Solve();
+      if (sol.empty())
+        continue;
+      s.Activate();
+      s.grid_.tilecache_ = nullptr; // time the check, not the cache
+      res.push_back({s.grid_, sol[0], PuzzleFamily(fam)});
+    }
+  }
+  return res;
+}
+
+struct RegionQuery {
+  Grid grid; // with part of a solution drawn
+  pair<int, int> cell;
+  vector<pair<int, int>> banned;
+};
+
+// The questions Solver::Prune asks: for every prefix of every solution, the
+// region of each open cell beside the end of the line, with the line's end
+// banned.
+const vector<RegionQuery> &RegionQueries() {
+  static vector<RegionQuery> res;
+  if (!res.empty())
+    return res;
+
+  const int dx[4] = {1, 0, -1, 0};
+  const int dy[4] = {0, 1, 0, -1};
+  for (int fam = 0; fam < kPuzzleFamilies; fam++) {
+    for (auto g : Panels(PuzzleFamily(fam))) {
+      Solver s(g);
+      s.seed_ = 1;
+      auto sol = s.Solve();
+      Grid grid = g;
+      grid.tilecache_ = nullptr;
+      grid.ClearPath();
+      for (size_t k = 0; k + 1 < sol.size(); k++) {
+        grid.SetOccupied(sol[k], true);
+        for (int d = 0; d < 4; d++) {
+          pair<int, int> c = {sol[k].first + dx[d], sol[k].second + dy[d]};
+          if (grid.Inside(c) && !grid.IsOccupied(c))
+            res.push_back({grid, c, {sol[k]}});
+        }
+      }
+    }
+  }
+  return res;
+}
+
+// The dispatch IsValid used before SymbolKind: one dynamic_pointer_cast per
+// candidate class, each copying the shared_ptr.
+int RttiKind(const std::shared_ptr<Entity> &o) {
+  if (std::dynamic_pointer_cast<BlockGroup>(o) != nullptr)
+    return 1;
+  if (std::dynamic_pointer_cast<Endpoint>(o) != nullptr)
+    return 2;
+  if (std::dynamic_pointer_cast<Dot>(o) != nullptr)
+    return 3;
+  if (std::dynamic_pointer_cast<Star>(o) != nullptr)
+    return 4;
+  if (std::dynamic_pointer_cast<Blob>(o) != nullptr)
+    return 5;
+  if (std::dynamic_pointer_cast<Triangle>(o) != nullptr)
+    return 6;
+  if (std::dynamic_pointer_cast<Cancel>(o) != nullptr)
+    return 7;
+  return 0;
+}
+
+int TagKind(const std::shared_ptr<Entity> &o) {
+  if (instanceof<BlockGroup>(o))
+    return 1;
+  if (instanceof<Endpoint>(o))
+    return 2;
+  if (instanceof<Dot>(o))
+    return 3;
+  if (instanceof<Star>(o))
+    return 4;
+  if (instanceof<Blob>(o))
+    return 5;
+  if (instanceof<Triangle>(o))
+    return 6;
+  if (instanceof<Cancel>(o))
+    return 7;
+  return 0;
+}
+
+// Every solved panel, or those of one family.
+void IsValidPanels(BenchState &state, int family) {
+  vector<Solved> grids;
+  for (auto &s : SolvedGrids())
+    if (family < 0 || s.family == family)
+      grids.push_back(s);
+  size_t i = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    Solved &s = grids[i];
+    DoNotOptimize(s.grid.IsValid(s.start.first, s.start.second));
+    if (++i == grids.size())
+      i = 0;
+  }
+  state.SetLabel(to_string(grids.size()) + " panels");
+}
+
+void BM_IsValid(BenchState &state) { IsValidPanels(state, -1); }
+void BM_IsValidChallengeBlocks(BenchState &state) {
+  IsValidPanels(state, kChallengeBlocks);
+}
+void BM_IsValidBlobs3(BenchState &state) { IsValidPanels(state, kBlobs3); }
+void BM_IsValidChallengeStars(BenchState &state) {
+  IsValidPanels(state, kChallengeStars);
+}
+void BM_IsValidTriangles(BenchState &state) {
+  IsValidPanels(state, kTriangles);
+}
+void BM_IsValidBlobs2(BenchState &state) { IsValidPanels(state, kBlobs2); }
+void BM_IsValidDots(BenchState &state) { IsValidPanels(state, kDots); }
+void BM_IsValidStars(BenchState &state) { IsValidPanels(state, kStars); }
+void BM_IsValidMaze(BenchState &state) { IsValidPanels(state, kMaze); }
+
+void BM_ValidateRegion(BenchState &state) {
+  vector<RegionQuery> queries = RegionQueries();
+  size_t i = 0;
+  int valid = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    RegionQuery &q = queries[i];
+    valid += q.grid.ValidateRegion(q.cell.first, q.cell.second, q.banned);
+    if (++i == queries.size())
+      i = 0;
+  }
+  DoNotOptimize(valid);
+  state.SetLabel(to_string(queries.size()) + " regions");
+}
+
+// One iteration classifies every cell of one panel.
+template <int (*Kind)(const std::shared_ptr<Entity> &)>
+void DispatchPanel(BenchState &state) {
+  const vector<Solved> &grids = SolvedGrids();
+  size_t i = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    int sum = 0;
+    for (auto &row : grids[i].grid.board_)
+      for (auto &e : row)
+        sum += Kind(e);
+    DoNotOptimize(sum);
+    if (++i == grids.size())
+      i = 0;
+  }
+}
+
+void BM_DispatchRtti(BenchState &state) { DispatchPanel<RttiKind>(state); }
+
+void BM_DispatchTag(BenchState &state) { DispatchPanel<TagKind>(state); }
+
+} // namespace
+
+BENCHMARK(BM_IsValid);
+BENCHMARK(BM_IsValidChallengeBlocks);
+BENCHMARK(BM_IsValidBlobs3);
+BENCHMARK(BM_IsValidChallengeStars);
+BENCHMARK(BM_IsValidTriangles);
+BENCHMARK(BM_IsValidBlobs2);
+BENCHMARK(BM_IsValidDots);
+BENCHMARK(BM_IsValidStars);
+BENCHMARK(BM_IsValidMaze);
+BENCHMARK(BM_ValidateRegion);
+BENCHMARK(BM_DispatchRtti);
+BENCHMARK(BM_DispatchTag);
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "bench.h"
+
+// Usage: witness_bench [filter]
+// Runs every registered benchmark whose name contains filter.
+
+int main(int argc, char **argv) {
+  const char *filter = argc > 1 ? argv[1] : "";
+  const double MIN_TIME = 0.2; // seconds per measured run
+
+  printf("%-40s %12s %14s %12s %12s\n", "Benchmark", "Iterations", "ns/op",
+         "allocs/op", "B/op");
+  for (auto &b : Benchmarks()) {
+    if (strstr(b.name.c_str(), filter) == nullptr)
+      continue;
+    int64_t n = 1;
+    while (true) {
+      BenchState state(n);
+      b.fn(state);
+      double t = state.Seconds();
+      if (t >= MIN_TIME || n >= ((int64_t)1 << 30)) {
+        std::string rate;
+        if (state.unit_ != nullptr)
+          rate = std::to_string((long long)(state.items_ / t)) + " " + state.unit_ +
+                 "/s ";
+        printf("%-40s %12lld %14.1f %12.1f %12.0f %s%s\n", b.name.c_str(),
+               (long long)n, t * 1e9 / n, state.Allocs(), state.AllocBytes(),
+               rate.c_str(), state.label_.c_str());
+        break;
+      }
+      n = t <= 0 ? n * 10 : std::min(n * 10, (int64_t)(n * MIN_TIME * 1.4 / t) + 1);
+    }
+  }
+  return 0;
+}
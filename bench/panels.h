@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include "witnessclone.h"
+
+using std::vector;
+
+/**
+ * @brief A fixed set of panels of one family. Seeds are fixed so runs compare
+ * across commits.
+ */
+inline const vector<Grid> &Panels(PuzzleFamily family) {
+  static vector<vector<Grid>> all;
+  if (!all.empty())
+    return all[family];
+
+  RandGrid rg;
+  rg.gen = mt19937(12345);
+  rg.g = mt19937(777);
+
+  all.resize(kPuzzleFamilies);
+  std::streambuf *old = cout.rdbuf(nullptr); // the generators are chatty
+  for (int i = 0; i < 8; i++) {
+    for (int fam = 0; fam < kPuzzleFamilies; fam++)
+      all[fam].push_back(rg.randFamily((PuzzleFamily)fam));
+  }
+  cout.rdbuf(old);
+  return all[family];
+}
@@ -0,0 +1,111 @@
+#include <filesystem>
+#include <random>
+
+#include "bench.h"
+#include "panels.h"
+#include "puzzlepack.h"
+
+// Puzzle packs: writing them, opening them, and reading panels at random.
+
+namespace {
+
+const size_t kPackPanels = 1 << 16;
+
+string PackPath(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+struct Solved {
+  vector<Grid> grids;
+  vector<vector<pair<int, int>>> lines;
+};
+
+// The bench panels of every family, with their solutions.
+const Solved &SolvedPanels() {
+  static Solved all;
+  if (all.grids.empty()) {
+    for (int fam = 0; fam < kPuzzleFamilies; fam++) {
+      for (auto g : Panels((PuzzleFamily)fam)) {
+        Solver s(g);
+        all.lines.push_back(s.Solve());
+        all.grids.push_back(g);
+      }
+    }
+  }
+  return all;
+}
+
+// SolvedPanels over and over until the pack holds count of them.
+void WritePack(const string &path, size_t count) {
+  const Solved &all = SolvedPanels();
+  size_t n = all.grids.size();
+  PackWriter w;
+  w.Open(path, all.grids[0].m_, all.grids[0].n_);
+  for (size_t i = 0; i < count; i++) {
+    PackEntry e = {};
+    e.family = i % n / (n / kPuzzleFamilies);
+    w.Add(all.grids[i % n], e, all.lines[i % n]);
+  }
+  w.Close();
+}
+
+const string &BigPack() {
+  static string path;
+  if (path.empty()) {
+    path = PackPath("witness_bench.pack");
+    WritePack(path, kPackPanels);
+  }
+  return path;
+}
+
+void BM_PackWrite(BenchState &state) {
+  string path = PackPath("witness_bench_write.pack");
+  SolvedPanels();
+  for ([[maybe_unused]] auto _ : state)
+    WritePack(path, 1024);
+  std::filesystem::remove(path);
+  state.SetLabel("1024 panels/op");
+}
+
+// Open only maps the file, so this should not grow with the pack.
+void BM_PackOpen(BenchState &state) {
+  const string &path = BigPack();
+  PuzzlePack pack;
+  for ([[maybe_unused]] auto _ : state) {
+    pack.Open(path);
+    DoNotOptimize(pack.Size());
+    pack.Close();
+  }
+  state.SetLabel(to_string(kPackPanels) + " panels");
+}
+
+// A random panel's cells, read in place.
+void BM_PackReadCells(BenchState &state) {
+  PuzzlePack pack;
+  pack.Open(BigPack());
+  mt19937 rng(1);
+  int cells = pack.Rows() * pack.Cols();
+  long long symbols = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    PackPanel p = pack.Panel(rng() % pack.Size());
+    for (int k = 0; k < cells; k++)
+      symbols += p.cells_[k].kind != SymbolKind::kNone;
+  }
+  DoNotOptimize(symbols);
+}
+
+// A random panel made into a Grid, as the game would deal it.
+void BM_PackToGrid(BenchState &state) {
+  PuzzlePack pack;
+  pack.Open(BigPack());
+  mt19937 rng(1);
+  for ([[maybe_unused]] auto _ : state)
+    DoNotOptimize(pack.Panel(rng() % pack.Size()).ToGrid().m_);
+}
+
+} // namespace
+
+BENCHMARK(BM_PackWrite);
+BENCHMARK(BM_PackOpen);
+BENCHMARK(BM_PackReadCells);
+BENCHMARK(BM_PackToGrid);
@@ -0,0 +1,65 @@
+#include "bench.h"
+#include "panels.h"
+
+// Where the generators get their paths (every path listed up front, against
+// one drawn when needed), and each generator on its own at 4x4.
+
+namespace {
+
+void BM_Pathfind(BenchState &state) {
+  RandGrid rg;
+  rg.gen = mt19937(12345);
+  for ([[maybe_unused]] auto _ : state) {
+    rg.pathfind();
+    DoNotOptimize(rg.possiblePaths.size());
+  }
+  state.SetLabel(to_string(rg.possiblePaths.size()) + " paths");
+}
+
+void BM_RandomPath(BenchState &state) {
+  RandGrid rg;
+  rg.gen = mt19937(12345);
+  long long cells = 0;
+  for ([[maybe_unused]] auto _ : state)
+    cells += rg.randomPath().size();
+  state.SetLabel(to_string(cells / state.iterations()) + " cells/path");
+}
+
+// One panel of family per iteration, from the same seeds every run.
+void GenerateFamily(BenchState &state, PuzzleFamily family) {
+  RandGrid rg;
+  rg.gen = mt19937(12345);
+  rg.g = mt19937(777);
+  std::streambuf *old = cout.rdbuf(nullptr); // the generators are chatty
+  for ([[maybe_unused]] auto _ : state)
+    DoNotOptimize(rg.randFamily(family).board_.size());
+  cout.rdbuf(old);
+}
+
+void BM_RandChallengeBlocks(BenchState &state) {
+  GenerateFamily(state, kChallengeBlocks);
+}
+void BM_RandBlobs3(BenchState &state) { GenerateFamily(state, kBlobs3); }
+void BM_RandChallengeStars(BenchState &state) {
+  GenerateFamily(state, kChallengeStars);
+}
+void BM_RandTriangles(BenchState &state) {
+  GenerateFamily(state, kTriangles);
+}
+void BM_RandBlobs2(BenchState &state) { GenerateFamily(state, kBlobs2); }
+void BM_RandDots(BenchState &state) { GenerateFamily(state, kDots); }
+void BM_RandStars(BenchState &state) { GenerateFamily(state, kStars); }
+void BM_RandMaze(BenchState &state) { GenerateFamily(state, kMaze); }
+
+} // namespace
+
+BENCHMARK(BM_Pathfind);
+BENCHMARK(BM_RandomPath);
+BENCHMARK(BM_RandChallengeBlocks);
+BENCHMARK(BM_RandBlobs3);
+BENCHMARK(BM_RandChallengeStars);
+BENCHMARK(BM_RandTriangles);
+BENCHMARK(BM_RandBlobs2);
+BENCHMARK(BM_RandDots);
+BENCHMARK(BM_RandStars);
+BENCHMARK(BM_RandMaze);
@@ -0,0 +1,132 @@
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "bench.h"
+#include "panels.h"
+
+// How generation and solving grow with the panel: n x n panels of every
+// family, for the game's 4x4 and up.
+
+namespace {
+
+// Longest a single solve may run. Bigger panels can take the solver far
+// longer than that, and those solves are cut off and counted as timeouts.
+const double kSolveBudget = 0.25; // seconds
+
+/**
+ * @class Deadline
+ * @brief Sets a flag once a number of seconds has passed, unless destroyed
+ * first
+ */
+class Deadline {
+public:
+  Deadline(std::atomic<bool> &flag, double seconds) : done_(false) {
+    thread_ = std::thread([this, &flag, seconds] {
+      std::unique_lock<std::mutex> guard(lock_);
+      if (!wake_.wait_for(guard, std::chrono::duration<double>(seconds),
+                          [this] { return done_; }))
+        flag = true;
+    });
+  }
+
+  ~Deadline() {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      done_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+private:
+  bool done_;
+  std::mutex lock_;
+  std::condition_variable wake_;
+  std::thread thread_;
+};
+
+// Fixed seeds, n x n panels.
+void Setup(RandGrid &rg, int n) {
+  rg.gen = mt19937(12345);
+  rg.g = mt19937(777);
+  rg.resize(n, n);
+}
+
+/** @brief Two n x n panels of every family, from fixed seeds */
+const vector<Grid> &SizedPanels(int n) {
+  static std::map<int, vector<Grid>> all;
+  auto it = all.find(n);
+  if (it != all.end())
+    return it->second;
+
+  RandGrid rg;
+  Setup(rg, n);
+  vector<Grid> panels;
+  std::streambuf *old = cout.rdbuf(nullptr);
+  for (int i = 0; i < 2; i++)
+    for (int fam = 0; fam < kPuzzleFamilies; fam++)
+      panels.push_back(rg.randFamily((PuzzleFamily)fam));
+  cout.rdbuf(old);
+  return all[n] = panels;
+}
+
+// One panel of every family per iteration.
+void Generate(BenchState &state, int n) {
+  RandGrid rg;
+  Setup(rg, n);
+  std::streambuf *old = cout.rdbuf(nullptr);
+  for ([[maybe_unused]] auto _ : state)
+    for (int fam = 0; fam < kPuzzleFamilies; fam++)
+      DoNotOptimize(rg.randFamily((PuzzleFamily)fam).board_.size());
+  cout.rdbuf(old);
+}
+
+// Every panel of SizedPanels(n) per iteration, each cut off after
+// kSolveBudget. Timed-out solves count at the budget.
+void Solve(BenchState &state, int n) {
+  const vector<Grid> &panels = SizedPanels(n);
+  Solver s;
+  s.seed_ = 1;
+  long long nodes = 0, timeouts = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto g : panels) {
+      std::atomic<bool> stop(false);
+      s.Set(g);
+      s.stop_ = &stop;
+      {
+        Deadline deadline(stop, kSolveBudget);
+        DoNotOptimize(s.Solve().size());
+      }
+      nodes += s.callstopath_;
+      timeouts += stop;
+      s.stop_ = nullptr;
+    }
+  }
+  state.SetItemsProcessed(nodes, "nodes");
+  state.SetLabel(to_string(nodes / state.iterations()) + " nodes/op, " +
+                 to_string(timeouts / state.iterations()) + "/" +
+                 to_string(panels.size()) + " timed out");
+}
+
+void BM_Generate4x4(BenchState &state) { Generate(state, 4); }
+void BM_Generate5x5(BenchState &state) { Generate(state, 5); }
+void BM_Generate6x6(BenchState &state) { Generate(state, 6); }
+void BM_Generate8x8(BenchState &state) { Generate(state, 8); }
+void BM_SolveSized4x4(BenchState &state) { Solve(state, 4); }
+void BM_SolveSized5x5(BenchState &state) { Solve(state, 5); }
+void BM_SolveSized6x6(BenchState &state) { Solve(state, 6); }
+void BM_SolveSized8x8(BenchState &state) { Solve(state, 8); }
+
+} // namespace
+
+BENCHMARK(BM_Generate4x4);
+BENCHMARK(BM_Generate5x5);
+BENCHMARK(BM_Generate6x6);
+BENCHMARK(BM_Generate8x8);
+BENCHMARK(BM_SolveSized4x4);
+BENCHMARK(BM_SolveSized5x5);
+BENCHMARK(BM_SolveSized6x6);
+BENCHMARK(BM_SolveSized8x8);
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <thread>
+
+#include "bench.h"
+#include "panels.h"
+
+// Solver::Solve from scratch, every panel of a family per iteration.
+
+namespace {
+
+// Each solve gets an empty tiling cache (or none), as a fresh panel would.
+void SolveFamily(BenchState &state, PuzzleFamily family, int threads = 1,
+                 bool cache = true) {
+  const vector<Grid> &panels = Panels(family);
+  Solver s;
+  s.threads_ = threads;
+  s.seed_ = 1;
+  long long nodes = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto g : panels) {
+      g.tilecache_ =
+          cache ? std::make_shared<TileCache>(TileCache::kCapacity) : nullptr;
+      s.Set(g);
+      DoNotOptimize(s.Solve().size());
+      nodes += s.callstopath_;
+    }
+  }
+  state.SetItemsProcessed(nodes, "nodes");
+  state.SetLabel(to_string(nodes / state.iterations()) + " nodes/op");
+}
+
+void BM_SolveChallengeBlocks(BenchState &state) {
+  SolveFamily(state, kChallengeBlocks);
+}
+void BM_SolveChallengeBlocksUncached(BenchState &state) {
+  SolveFamily(state, kChallengeBlocks, 1, false);
+}
+void BM_SolveBlobs3(BenchState &state) { SolveFamily(state, kBlobs3); }
+void BM_SolveChallengeStars(BenchState &state) {
+  SolveFamily(state, kChallengeStars);
+}
+void BM_SolveTriangles(BenchState &state) { SolveFamily(state, kTriangles); }
+void BM_SolveBlobs2(BenchState &state) { SolveFamily(state, kBlobs2); }
+void BM_SolveDots(BenchState &state) { SolveFamily(state, kDots); }
+void BM_SolveStars(BenchState &state) { SolveFamily(state, kStars); }
+void BM_SolveMaze(BenchState &state) { SolveFamily(state, kMaze); }
+
+// Uniqueness checks: stop at the second solution, against counting them all.
+void CountFamily(BenchState &state, PuzzleFamily family, long long limit) {
+  const vector<Grid> &panels = Panels(family);
+  Solver s;
+  s.seed_ = 1;
+  long long found = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    for (auto g : panels) {
+      s.Set(g);
+      found += s.CountSolutions(limit);
+    }
+  }
+  state.SetLabel(to_string(found / state.iterations()) + " solutions/op");
+}
+
+void BM_UniqueStars(BenchState &state) { CountFamily(state, kStars, 2); }
+void BM_CountStars(BenchState &state) { CountFamily(state, kStars, 0); }
+void BM_UniqueDots(BenchState &state) { CountFamily(state, kDots, 2); }
+void BM_CountDots(BenchState &state) { CountFamily(state, kDots, 0); }
+
+// The same panels on every core.
+int Cores() { return std::max(1u, std::thread::hardware_concurrency()); }
+void BM_SolveChallengeBlocksParallel(BenchState &state) {
+  SolveFamily(state, kChallengeBlocks, Cores());
+}
+void BM_SolveBlobs3Parallel(BenchState &state) {
+  SolveFamily(state, kBlobs3, Cores());
+}
+
+} // namespace
+
+BENCHMARK(BM_SolveChallengeBlocks);
+BENCHMARK(BM_SolveChallengeBlocksUncached);
+BENCHMARK(BM_SolveBlobs3);
+BENCHMARK(BM_SolveChallengeStars);
+BENCHMARK(BM_SolveTriangles);
+BENCHMARK(BM_SolveBlobs2);
+BENCHMARK(BM_SolveDots);
+BENCHMARK(BM_SolveStars);
+BENCHMARK(BM_SolveMaze);
+BENCHMARK(BM_UniqueStars);
+BENCHMARK(BM_CountStars);
+BENCHMARK(BM_UniqueDots);
+BENCHMARK(BM_CountDots);
+BENCHMARK(BM_SolveChallengeBlocksParallel);
+BENCHMARK(BM_SolveBlobs3Parallel);
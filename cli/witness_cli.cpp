@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alloctrack.h"
+#include "grid.h"
+#include "gridtext.h"
+#include "randgrid.h"
+#include "solver.h"
+
+// witness-cli: the generator, solver and checker without a window, for CI
+// and batch machines.
+//
+//   witness-cli [-n count] [-f family] [-s size] [--seed s] [-i in] [-o out]
+//
+// Makes count panels (or reads them from a text file written by -o), solves
+// every one, checks each solution with Grid::IsValid on a fresh copy of the
+// panel and prints throughput and latency, and in a WITNESS_ALLOC_TRACKING
+// build the allocations of every solve and check. Exits 1 if any panel has
+// no solution or a solution fails the check.
+
+using std::string;
+using std::vector;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char *const kFamilyNames[kPuzzleFamilies] = {
+    "challenge-blocks", "blobs3", "challenge-stars", "triangles",
+    "blobs2",           "dots",   "stars",           "maze"};
+
+struct Options {
+  long long count = 100;
+  int family = -1; // every family in turn
+  int rows = 4;    // panel cells, not grid cells
+  int cols = 4;
+  unsigned seed = 0; // from the clock
+  string in, out;
+};
+
+void Usage() {
+  fprintf(stderr,
+          "usage: witness-cli [-n count] [-f family] [-s size] [--seed s]\n"
+          "                   [-i panels.txt] [-o panels.txt]\n"
+          "  -n count    panels to make (default 100)\n"
+          "  -f family   one family (default: all in turn), one of\n"
+          "             ");
+  for (int f = 0; f < kPuzzleFamilies; f++)
+    fprintf(stderr, " %s", kFamilyNames[f]);
+  fprintf(stderr,
+          "\n"
+          "  -s RxC      panel size in cells (default 4x4, -s 5 for 5x5)\n"
+          "  --seed s    generator seed (default: from the clock)\n"
+          "  -i file     solve the panels of a text file instead\n"
+          "  -o file     also write the panels to a text file\n");
+}
+
+bool ParseOptions(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; i++) {
+    string a = argv[i];
+    if (a == "-h" || a == "--help")
+      return false;
+    if (i + 1 >= argc) {
+      fprintf(stderr, "witness-cli: %s needs a value\n", a.c_str());
+      return false;
+    }
+    const char *v = argv[++i];
+    if (a == "-n") {
+      o.count = atoll(v);
+    } else if (a == "-f") {
+      o.family = -1;
+      for (int f = 0; f < kPuzzleFamilies; f++)
+        if (strcmp(v, kFamilyNames[f]) == 0)
+          o.family = f;
+      if (o.family < 0 && strcmp(v, "all") != 0) {
+        fprintf(stderr, "witness-cli: no family %s\n", v);
+        return false;
+      }
+    } else if (a == "-s") {
+      if (sscanf(v, "%dx%d", &o.rows, &o.cols) == 1)
+        o.cols = o.rows;
+      if (o.rows < 2 || o.cols < 2) {
+        fprintf(stderr, "witness-cli: bad size %s\n", v);
+        return false;
+      }
+    } else if (a == "--seed") {
+      o.seed = strtoul(v, nullptr, 10);
+    } else if (a == "-i") {
+      o.in = v;
+    } else if (a == "-o") {
+      o.out = v;
+    } else {
+      fprintf(stderr, "witness-cli: unknown option %s\n", a.c_str());
+      return false;
+    }
+  }
+  return o.count >= 0;
+}
+
+double Since(Clock::time_point t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+/**
+ * @brief Check sol on a copy of g, without the solver
+ *
+ * The line must step between neighbouring cells a line may pass, never visit
+ * a cell twice, and leave g valid from its first cell.
+ */
+bool Verify(const Grid &g, const vector<pair<int, int>> &sol) {
+  if (sol.empty())
+    return false;
+  Grid v = g;
+  v.ClearPath();
+  for (size_t k = 0; k < sol.size(); k++) {
+    auto p = sol[k];
+    if (p.first < 0 || p.second < 0 || p.first >= v.m_ || p.second >= v.n_)
+      return false;
+    if (!v.IsPath(p) || v.IsOccupied(p))
+      return false;
+    if (k > 0 && abs(p.first - sol[k - 1].first) +
+                         abs(p.second - sol[k - 1].second) !=
+                     1)
+      return false;
+    v.SetOccupied(p, true);
+  }
+  return v.IsValid(sol[0].first, sol[0].second);
+}
+
+// Latency of one stage over every panel.
+struct Stage {
+  const char *name;
+  vector<double> seconds;
+
+  explicit Stage(const char *n) : name(n) {}
+
+  void Print() {
+    if (seconds.empty())
+      return;
+    std::sort(seconds.begin(), seconds.end());
+    double total = 0;
+    for (double s : seconds)
+      total += s;
+    auto at = [&](double q) {
+      return seconds[std::min(seconds.size() - 1,
+                              (size_t)(q * seconds.size()))] *
+             1e6;
+    };
+    printf("%-9s %10.0f/s  mean %9.1f us  p50 %9.1f  p90 %9.1f  p99 %9.1f  "
+           "max %9.1f\n",
+           name, seconds.size() / total, total / seconds.size() * 1e6,
+           at(0.5), at(0.9), at(0.99), seconds.back() * 1e6);
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options o;
+  if (!ParseOptions(argc, argv, o)) {
+    Usage();
+    return 2;
+  }
+
+  GridTextReader reader;
+  if (!o.in.empty() && !reader.Open(o.in)) {
+    fprintf(stderr, "witness-cli: cannot read %s\n", o.in.c_str());
+    return 2;
+  }
+  GridTextWriter writer;
+  if (!o.out.empty() && !writer.Open(o.out)) {
+    fprintf(stderr, "witness-cli: cannot write %s\n", o.out.c_str());
+    return 2;
+  }
+
+  RandGrid rg;
+  unsigned seed = o.seed != 0 ? o.seed : std::random_device()();
+  rg.gen = mt19937(seed);
+  rg.g = mt19937(seed ^ 0x5bd1e995);
+  rg.resize(o.rows, o.cols);
+
+  // The generators and the solver talk on cout; the report is printf's.
+  std::streambuf *old = std::cout.rdbuf(nullptr);
+
+  Stage gen("generate"), solve("solve"), verify("verify");
+  long long panels = 0, unsolved = 0, invalid = 0, nodes = 0;
+  auto start = Clock::now();
+  for (long long i = 0; o.in.empty() ? i < o.count : true; i++) {
+    Grid g;
+    auto t = Clock::now();
+    if (!o.in.empty()) {
+      if (!reader.Next(g))
+        break;
+    } else {
+      int f = o.family >= 0 ? o.family : i % kPuzzleFamilies;
+      g = rg.randFamily((PuzzleFamily)f);
+      gen.seconds.push_back(Since(t));
+    }
+    if (!o.out.empty())
+      writer.Write(g);
+    panels++;
+
+    t = Clock::now();
+    Solver s(g);
+    s.seed_ = 1;
+    vector<pair<int, int>> sol = s.Solve();
+    solve.seconds.push_back(Since(t));
+    nodes += s.callstopath_;
+    if (sol.empty()) {
+      unsolved++;
+      continue;
+    }
+
+    t = Clock::now();
+    bool ok = Verify(g, sol);
+    verify.seconds.push_back(Since(t));
+    invalid += !ok;
+  }
+  double total = Since(start);
+  std::cout.rdbuf(old);
+
+  bool failed = unsolved > 0 || invalid > 0;
+  if (!o.in.empty() && reader.Failed()) {
+    fprintf(stderr, "witness-cli: %s: malformed panel after %lld\n",
+            o.in.c_str(), panels);
+    failed = true;
+  }
+  if (!o.out.empty() && !writer.Close()) {
+    fprintf(stderr, "witness-cli: writing %s failed\n", o.out.c_str());
+    failed = true;
+  }
+
+  if (o.in.empty())
+    printf("%lld panels, %dx%d, %s, seed %u\n", panels, o.rows, o.cols,
+           o.family >= 0 ? kFamilyNames[o.family] : "all families", seed);
+  else
+    printf("%lld panels from %s\n", panels, o.in.c_str());
+  printf("%lld solved, %lld unsolved, %lld invalid, %.1f nodes/solve\n",
+         panels - unsolved, unsolved, invalid,
+         panels > 0 ? (double)nodes / panels : 0.0);
+  printf("%.3f s, %.0f panels/s\n", total, panels / total);
+  gen.Print();
+  solve.Print();
+  verify.Print();
+#ifdef WITNESS_ALLOC_TRACKING
+  printf("\n");
+  PrintAllocStats(stdout);
+#endif
+  return failed ? 1 : 0;
+}
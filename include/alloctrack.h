@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Allocation counting for the verifier and solver, compiled in only with
+// WITNESS_ALLOC_TRACKING (cmake -DWITNESS_ALLOC_TRACKING=ON). That build
+// replaces the global operator new to count every allocation and its bytes
+// against the innermost AllocScope open on the allocating thread. Without
+// the flag AllocScope is empty and compiles away.
+
+// Where allocations are counted. IsValid's phases are named after the
+// sections of Grid::IsValid.
+enum AllocSite {
+  kAllocSolve,          // Solver::Solve, on the calling thread
+  kAllocIsValid,        // Grid::IsValid
+  kAllocFox,            // start, end, dots and triangles
+  kAllocWolf,           // blobs and stars
+  kAllocDrude,          // polyominos
+  kAllocPhoenix,        // cancels
+  kAllocValidateRegion, // Grid::ValidateRegion
+
+  kAllocSites
+};
+
+struct AllocStats {
+  int64_t calls;  // times a scope at the site was opened
+  int64_t allocs; // inside those scopes, nested scopes included
+  int64_t bytes;
+  int64_t selfallocs; // with no scope nested deeper open
+  int64_t selfbytes;
+};
+
+#ifdef WITNESS_ALLOC_TRACKING
+
+/**
+ * @class AllocScope
+ * @brief Counts what the calling thread allocates until it is destroyed
+ *
+ * Scopes nest: an allocation counts in full (allocs, bytes) for every scope
+ * open around it and as its own (selfallocs, selfbytes) for the innermost.
+ * Switch closes the scope and opens it again at another site, for code that
+ * runs in phases.
+ */
+class AllocScope {
+public:
+  explicit AllocScope(AllocSite site);
+
+  ~AllocScope();
+
+  AllocScope(const AllocScope &) = delete;
+  AllocScope &operator=(const AllocScope &) = delete;
+
+  void Switch(AllocSite site);
+
+private:
+  AllocSite site_;
+  int outer_; // the site open around this one, -1 for none
+  int64_t allocs_;
+  int64_t bytes_;
+
+  void Close();
+};
+
+AllocStats GetAllocStats(AllocSite site);
+
+void ResetAllocStats();
+
+/** @brief Allocations and bytes by every thread, in or out of a scope */
+AllocStats AllocTotals();
+
+/** @brief A table of every site: calls, then allocations and bytes per call */
+void PrintAllocStats(std::FILE *out);
+
+#else
+
+class AllocScope {
+public:
+  explicit AllocScope(AllocSite) {}
+
+  void Switch(AllocSite) {}
+};
+
+#endif
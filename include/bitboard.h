@@ -0,0 +1,101 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @class Bitboard
+ * @brief One bit per grid cell, packed into 64-bit words
+ *
+ * Cells are addressed by their flat index (row * columns + column), the same
+ * index used by Grid::cells_. A 9x9 panel fits in two words and a 21x21 panel
+ * in seven, so whole-board scans stay inside a couple of cache lines.
+ */
+class Bitboard {
+public:
+  vector<uint64_t> words_;
+  int size_;
+
+  Bitboard() : size_(0) {}
+  Bitboard(int size) : words_((size + 63) >> 6, 0), size_(size) {}
+
+  int size() const { return size_; }
+
+  bool test(int i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+
+  void set(int i) { words_[i >> 6] |= uint64_t(1) << (i & 63); }
+
+  void reset(int i) { words_[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+  void assign(int i, bool b) {
+    if (b)
+      set(i);
+    else
+      reset(i);
+  }
+
+  void clear() {
+    for (auto &w : words_)
+      w = 0;
+  }
+
+  bool any() const {
+    for (auto w : words_)
+      if (w)
+        return true;
+    return false;
+  }
+
+  Bitboard operator&(const Bitboard &o) const {
+    Bitboard res(*this);
+    for (size_t i = 0; i < words_.size(); i++)
+      res.words_[i] &= o.words_[i];
+    return res;
+  }
+
+  Bitboard operator|(const Bitboard &o) const {
+    Bitboard res(*this);
+    for (size_t i = 0; i < words_.size(); i++)
+      res.words_[i] |= o.words_[i];
+    return res;
+  }
+
+  // Bits past size() stay clear, so count() and any() remain exact.
+  Bitboard operator~() const {
+    Bitboard res(*this);
+    for (auto &w : res.words_)
+      w = ~w;
+    if (size_ & 63)
+      res.words_.back() &= (uint64_t(1) << (size_ & 63)) - 1;
+    return res;
+  }
+
+  /**
+   * @brief Word w of this board moved k cells toward higher indices (k < 0
+   * moves toward lower ones). Cells moved past either end are dropped.
+   */
+  uint64_t shifted(int w, int k) const {
+    int from = w * 64 - k; // index of the cell that lands on bit 0
+    int q = from >> 6, r = from & 63; // floor, for negative from too
+    uint64_t res = word(q) >> r;
+    if (r != 0)
+      res |= word(q + 1) << (64 - r);
+    return res;
+  }
+
+  /** @brief Word q, or 0 past either end */
+  uint64_t word(int q) const {
+    return q >= 0 && q < (int)words_.size() ? words_[q] : 0;
+  }
+
+  int count() const {
+    int res = 0;
+    for (auto w : words_)
+      res += std::popcount(w);
+    return res;
+  }
+};
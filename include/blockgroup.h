@@ -12,6 +12,13 @@ using std::set;
 using std::string;
 using std::vector;
 
+/**
+ * @brief How BlockGroup::solve searches for a tiling. Both give the same
+ * answer: kBacktrack places the pieces in the order given, kExactCover fills
+ * the most constrained cell first.
+ */
+enum class Tiler { kBacktrack, kExactCover };
+
 class BlockGroup : public Entity {
 public:
   bool oriented;
@@ -76,5 +83,5 @@ public:
 
   bool dfsUtil(BlockGroup region, vector<BlockGroup> &v, int index);
 
-  bool solve(vector<BlockGroup> v);
+  bool solve(vector<BlockGroup> v, Tiler tiler = Tiler::kExactCover);
 };
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <vector>
+
+#include "grid.h"
+#include "randgrid.h"
+#include "threadpool.h"
+
+using std::vector;
+
+/**
+ * @struct Rating
+ * @brief What the solver makes of a panel
+ *
+ * solutions is counted only up to the limit the rating was made with, so it
+ * tells unsolvable, unique and ambiguous panels apart without enumerating
+ * every line of an easy one. nodes is the solver's callstopath_ to the first
+ * solution from seed 1, a stand-in for how hard the panel is.
+ */
+struct Rating {
+  long long solutions;
+  int nodes;
+};
+
+/**
+ * @struct Filter
+ * @brief Which rated panels Curator keeps
+ *
+ * Unsolvable panels are always dropped. maxsolutions of 0 keeps panels with
+ * any number of solutions, 1 only unique ones.
+ */
+struct Filter {
+  long long maxsolutions = 0;
+  int minnodes = 0;
+  int maxnodes = INT_MAX;
+};
+
+/**
+ * @class Curator
+ * @brief Makes panels, rates them with the solver and keeps the ones a
+ * Filter accepts, on a pool of threads
+ *
+ * Every worker runs generate, solve, count and filter on its own RandGrid
+ * and its own Solver until enough panels are kept or the attempts run out,
+ * so the workers share nothing but the counters and the result list. The
+ * order of the panels kept depends on timing.
+ */
+class Curator {
+public:
+  struct Panel {
+    Grid grid;
+    Rating rating;
+  };
+
+  // Counters over the last Make.
+  long long generated_;  // panels made
+  long long accepted_;   // kept
+  long long unsolvable_; // dropped for having no solution
+  long long ambiguous_;  // dropped for too many solutions
+  long long outside_;    // dropped for nodes out of [minnodes, maxnodes]
+  double seconds_;       // wall time
+
+  /**
+   * @param threads (workers in the pool)
+   * @param seed (of the generators, 0 to take one from random_device)
+   */
+  Curator(int threads, unsigned seed = 0);
+
+  /** @brief Rate g, counting solutions up to limit (0 for all of them) */
+  static Rating Rate(Grid &g, long long limit);
+
+  /**
+   * @brief Make panels of family until count pass filter
+   *
+   * @param attempts (give up after generating this many)
+   * @return the panels kept, fewer than count if the attempts ran out
+   */
+  vector<Panel> Make(PuzzleFamily family, int count, const Filter &filter,
+                     long long attempts);
+
+  /** @brief Panels kept per second of the last Make */
+  double Throughput() const { return seconds_ > 0 ? accepted_ / seconds_ : 0; }
+
+private:
+  ThreadPool pool_;
+  vector<std::unique_ptr<RandGrid>> generators_; // one per worker
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "bitboard.h"
+#include "blockgroup.h"
 #include "object.h"
+#include "tilecache.h"
 #include "util.h"
 #include <memory>
 #include <set>
@@ -10,6 +13,20 @@ using std::set;
 using std::string;
 using std::vector;
 
+/**
+ * @struct Cell
+ * @brief Compact copy of the symbol sitting on one grid cell
+ *
+ * arg is the triangle count for triangles and 0 otherwise. color is an index
+ * into kPalette.
+ */
+struct Cell {
+  SymbolKind kind;
+  unsigned char color;
+  unsigned char arg;
+  unsigned char pad;
+};
+
 class Grid {
 public:
   int m_; // lines
@@ -25,8 +42,21 @@ public:
   set<pair<int, int>> cancels_;   // Zen (Inverse Y)
   set<pair<int, int>> ignored_;   // Ignored cancel operations
 
+  // The compact grid core. board_ keeps the symbol objects themselves (the
+  // polyomino shapes live there), everything the verifier and the solver
+  // probe per cell lives here, indexed by Index().
+  vector<Cell> cells_;
+  Bitboard pathable_;                                 // is_path_
+  Bitboard occupied_;                                 // is_path_occupied_
+  Bitboard symbols_[static_cast<int>(SymbolKind::kCount)]; // one per kind
+
   pair<int, int> begin_; // the begin point of the line you drawing
 
+  // How IsValid, ValidateRegion and the solver's checks tile block regions,
+  // and the answers so far (shared by copies of the grid, null for none)
+  Tiler tiler_;
+  std::shared_ptr<TileCache> tilecache_;
+
   Grid();
 
   Grid(vector<vector<std::shared_ptr<Entity>>> &v);
@@ -45,14 +75,51 @@ public:
 
   virtual ~Grid();
 
-  string ToString();
+  // The destructor would otherwise make every move a copy.
+  Grid(const Grid &) = default;
+  Grid(Grid &&) = default;
+  Grid &operator=(const Grid &) = default;
+  Grid &operator=(Grid &&) = default;
+
+  string ToString() const;
 
   void Display();
 
+  // The grid core
+
+  int Index(pair<int, int> p) const { return p.first * n_ + p.second; }
+
+  bool IsPath(pair<int, int> p) const { return pathable_.test(Index(p)); }
+
+  bool IsOccupied(pair<int, int> p) const {
+    return occupied_.test(Index(p));
+  }
+
+  void SetPath(pair<int, int> p, bool b) { pathable_.assign(Index(p), b); }
+
+  void SetOccupied(pair<int, int> p, bool b) {
+    occupied_.assign(Index(p), b);
+  }
+
+  /** @brief Erase every path segment from the grid */
+  void ClearPath() { occupied_.clear(); }
+
+  const Cell &CellAt(pair<int, int> p) const { return cells_[Index(p)]; }
+
+  SymbolKind KindAt(pair<int, int> p) const { return cells_[Index(p)].kind; }
+
+  /**
+   * @brief Put a symbol on a cell, keeping board_, the symbol lists and the
+   * grid core consistent. The path state of the cell is left alone.
+   */
+  void Place(pair<int, int> p, std::shared_ptr<Entity> e);
+
   // The verification algorithm
 
   /** @brief check if the point p is inside the grid */
-  bool Inside(pair<int, int> p);
+  bool Inside(pair<int, int> p) const {
+    return p.first >= 0 && p.second >= 0 && p.first < m_ && p.second < n_;
+  }
 
   /**
    * @brief check if the point (sx, sy) is valid
@@ -66,4 +133,10 @@ public:
   bool Check();
 
   bool ValidateRegion(int sx, int sy, vector<pair<int, int>> ban);
+
+  /** @brief Can pieces tile region? Goes through tilecache_ if there is one */
+  bool Tile(BlockGroup &region, vector<BlockGroup> &pieces);
+
+private:
+  set<pair<int, int>> *SymbolList(SymbolKind k);
 };
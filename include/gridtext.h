@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+
+using std::string;
+using std::vector;
+
+// A text form of Grid that reads back to the same panel, for corpora of
+// panels that can be diffed and fed to batch tools. One panel is
+//
+//   panel <rows> <cols>
+//   <rows lines of cols cells, separated by one space>
+//   block <slot> <flags> <x>,<y> <x>,<y> ...   (one line per polyomino)
+//   end
+//
+// and a cell is four characters:
+//
+//   kind   . none  S start  E end  o dot  b blob  * star  t triangle
+//          y cancel  # block
+//   color  the index into kPalette (0 for none)
+//   arg    the triangle count, or the block's slot, in base 36
+//   path   _ no line may pass  + a line may pass  @ the line is here
+//          ! the line is here though no line may pass
+//
+// so a cut is ".00_", a start "S00+" and a yellow block in slot 0 "#40_".
+// A block line gives its slot, "o" or "-" for oriented, "s" or "-" for
+// subtractive, and the squares of the polyomino. Slots are numbered in row
+// order, so a panel holds at most 36 polyominos. Blank lines between panels
+// are skipped.
+
+/**
+ * @brief Append the text of g to out, growing out at most once
+ *
+ * @return false, appending nothing, if g has more than 36 polyominos
+ */
+bool AppendGridText(const Grid &g, string &out);
+
+/**
+ * @brief Parse one panel from the text at p, moving p past it
+ *
+ * @return false at the end of the text or on malformed input (p is then
+ * left where the panel started)
+ */
+bool ParseGridText(const char *&p, const char *end, Grid &g);
+
+/**
+ * @class GridTextWriter
+ * @brief Writes panels to a text file one at a time, through one buffer
+ */
+class GridTextWriter {
+public:
+  GridTextWriter();
+
+  ~GridTextWriter();
+
+  GridTextWriter(const GridTextWriter &) = delete;
+  GridTextWriter &operator=(const GridTextWriter &) = delete;
+
+  bool Open(const string &path);
+
+  /** @brief Add g to the file, or fail Close if g cannot be written */
+  void Write(const Grid &g);
+
+  /** @brief Flush and close. False if any write failed. */
+  bool Close();
+
+private:
+  std::FILE *file_;
+  string buffer_;
+  bool ok_;
+
+  void Flush();
+};
+
+/**
+ * @class GridTextReader
+ * @brief Reads the panels of a text file one at a time
+ *
+ * Open reads the whole file, Next parses the panel after the last one.
+ */
+class GridTextReader {
+public:
+  GridTextReader();
+
+  bool Open(const string &path);
+
+  /** @brief The next panel into g. False at the end or on malformed text. */
+  bool Next(Grid &g);
+
+  /** @brief True if Next stopped at malformed text, not the end */
+  bool Failed() const;
+
+  /** @brief Bytes of text in the file */
+  size_t Size() const { return text_.size(); }
+
+private:
+  string text_;
+  const char *at_;
+};
@@ -5,7 +5,10 @@
 class Endpoint : public Entity {
 public:
   bool starting_;
-  Endpoint(bool s) : Entity(), starting_(s) { is_path_ = true; }
+  Endpoint(bool s) : Entity(), starting_(s) {
+    is_path_ = true;
+    kind_ = s ? SymbolKind::kStart : SymbolKind::kEnd;
+  }
 };
 
 /**
@@ -15,7 +18,10 @@ public:
  */
 class Dot : public Entity {
 public:
-  Dot() : Entity() { is_path_ = true; }
+  Dot() : Entity() {
+    is_path_ = true;
+    kind_ = SymbolKind::kDot;
+  }
 };
 
 /**
@@ -25,21 +31,25 @@ public:
  */
 class Blob : public Entity {
 public:
-  Blob() : Entity(EntityColor::kBLACK) {}
-  Blob(EntityColor c) : Entity(c) {}
+  Blob() : Entity(EntityColor::kBLACK) { kind_ = SymbolKind::kBlob; }
+  Blob(EntityColor c) : Entity(c) { kind_ = SymbolKind::kBlob; }
 };
 
 class Star : public Entity {
 public:
-  Star() : Entity(EntityColor::kWHITE) {}
-  Star(EntityColor c) : Entity(c) {}
+  Star() : Entity(EntityColor::kWHITE) { kind_ = SymbolKind::kStar; }
+  Star(EntityColor c) : Entity(c) { kind_ = SymbolKind::kStar; }
 };
 
 class Triangle : public Entity {
 public:
   int x_;
-  Triangle(int n) : Entity(EntityColor::kORANGE), x_(n) {}
-  Triangle(int n, EntityColor c) : Entity(c), x_(n) {}
+  Triangle(int n) : Entity(EntityColor::kORANGE), x_(n) {
+    kind_ = SymbolKind::kTriangle;
+  }
+  Triangle(int n, EntityColor c) : Entity(c), x_(n) {
+    kind_ = SymbolKind::kTriangle;
+  }
 };
 
 /**
@@ -50,5 +60,5 @@ public:
 class Cancel : public Entity {
 public:
   bool ignored_;
-  Cancel() : Entity(), ignored_(false) {}
+  Cancel() : Entity(), ignored_(false) { kind_ = SymbolKind::kCancel; }
 };
@@ -26,16 +26,57 @@ enum class EntityColor {
   kSP1 = 0x8AD8FF
 };
 
+// Every color above in a fixed order, so a color fits in one byte of the
+// compact grid core (see Grid::cells_). Index 0 is NIL.
+inline constexpr EntityColor kPalette[] = {
+    EntityColor::NIL,     EntityColor::kRED,    EntityColor::kGREEN,
+    EntityColor::kBLUE,   EntityColor::kYELLOW, EntityColor::kCYAN,
+    EntityColor::kMAGENTA, EntityColor::kBLACK, EntityColor::kWHITE,
+    EntityColor::kORANGE, EntityColor::kGREY,   EntityColor::kDARK,
+    EntityColor::kLIGHT,  EntityColor::kSP2,    EntityColor::kSP1};
+
+inline constexpr int kPaletteSize = sizeof(kPalette) / sizeof(kPalette[0]);
+
+inline int PaletteIndex(EntityColor c) {
+  for (int i = 0; i < kPaletteSize; i++)
+    if (kPalette[i] == c)
+      return i;
+  return 0;
+}
+
+// What occupies a cell, one value per concrete symbol class.
+enum class SymbolKind : unsigned char {
+  kNone = 0, // Plain Entity (empty cell, path segment or cut)
+  kStart,    // Endpoint, starting
+  kEnd,      // Endpoint, ending
+  kDot,
+  kBlob,
+  kStar,
+  kTriangle,
+  kCancel,
+  kBlock,
+
+  kCount
+};
+
 class Entity {
 public:
   EntityColor color_;
+  // Initial path state, read once when a Grid is built from entities. After
+  // that the grid's own bitboards are authoritative (Grid::IsPath and
+  // Grid::IsOccupied).
   bool is_path_;          // Is Pathable (false if cut or is symbol cell)
   bool is_path_occupied_; // Is there a path here
+  // Concrete symbol class, set by each subclass constructor. Type checks
+  // (instanceof, get_type, the verifier) switch on this instead of RTTI.
+  SymbolKind kind_;
 
   Entity()
-      : is_path_(false), is_path_occupied_(false), color_(EntityColor::NIL) {}
+      : is_path_(false), is_path_occupied_(false), color_(EntityColor::NIL),
+        kind_(SymbolKind::kNone) {}
   Entity(EntityColor c)
-      : is_path_(false), is_path_occupied_(false), color_(c) {}
+      : is_path_(false), is_path_occupied_(false), color_(c),
+        kind_(SymbolKind::kNone) {}
 
   std::shared_ptr<Entity> Clear() {
     auto res = std::make_shared<Entity>();
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bitboard.h"
+
+using std::pair;
+using std::vector;
+
+/**
+ * @class PathMask
+ * @brief The cells a line passes through, one bit per cell of an m x n grid
+ *
+ * Takes the place of a set<pair<int, int>> of cells: contains() is a single
+ * bit test, and iterating yields the cells in the order the set did (by row,
+ * then column).
+ */
+class PathMask {
+public:
+  int m_;
+  int n_;
+  Bitboard bits_;
+
+  PathMask() : m_(0), n_(0) {}
+  PathMask(int m, int n) : m_(m), n_(n), bits_(m * n) {}
+
+  bool contains(pair<int, int> p) const {
+    return p.first >= 0 && p.second >= 0 && p.first < m_ && p.second < n_ &&
+           bits_.test(p.first * n_ + p.second);
+  }
+
+  void insert(pair<int, int> p) { bits_.set(p.first * n_ + p.second); }
+
+  int size() const { return bits_.count(); }
+
+  bool empty() const { return !bits_.any(); }
+
+  class Iterator {
+  public:
+    Iterator(const PathMask *mask, int at) : mask_(mask), at_(at) { Skip(); }
+
+    pair<int, int> operator*() const {
+      return {at_ / mask_->n_, at_ % mask_->n_};
+    }
+
+    Iterator &operator++() {
+      at_++;
+      Skip();
+      return *this;
+    }
+
+    bool operator!=(const Iterator &o) const { return at_ != o.at_; }
+
+  private:
+    const PathMask *mask_;
+    int at_;
+
+    // On to the next set bit, or size() if there is none.
+    void Skip() {
+      const vector<uint64_t> &words = mask_->bits_.words_;
+      int size = mask_->bits_.size();
+      while (at_ < size) {
+        uint64_t w = words[at_ >> 6] >> (at_ & 63);
+        if (w != 0) {
+          at_ += std::countr_zero(w);
+          return;
+        }
+        at_ = (at_ | 63) + 1;
+      }
+      at_ = size;
+    }
+  };
+
+  Iterator begin() const { return Iterator(this, 0); }
+
+  Iterator end() const { return Iterator(this, bits_.size()); }
+};
+
+/**
+ * @class PathArena
+ * @brief A list of PathMasks of one grid size, packed back to back
+ *
+ * Every path takes the same few words (two on a 9x9 panel) in one shared
+ * vector, with no allocation or pointer per path. operator[] hands a path
+ * back as a PathMask.
+ */
+class PathArena {
+public:
+  PathArena() : m_(0), n_(0), stride_(0), count_(0) {}
+
+  size_t size() const { return count_; }
+
+  bool empty() const { return count_ == 0; }
+
+  void clear() {
+    words_.clear();
+    count_ = 0;
+  }
+
+  /** @brief Add a path. Every path must share the first one's grid size. */
+  void push_back(const PathMask &p) {
+    if (count_ == 0) {
+      m_ = p.m_;
+      n_ = p.n_;
+      stride_ = p.bits_.words_.size();
+    }
+    words_.insert(words_.end(), p.bits_.words_.begin(), p.bits_.words_.end());
+    count_++;
+  }
+
+  PathMask operator[](size_t i) const {
+    PathMask res(m_, n_);
+    std::copy(words_.begin() + i * stride_, words_.begin() + (i + 1) * stride_,
+              res.bits_.words_.begin());
+    return res;
+  }
+
+private:
+  int m_;
+  int n_;
+  size_t stride_; // words per path
+  size_t count_;
+  vector<uint64_t> words_;
+};
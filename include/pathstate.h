@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+
+#include "grid.h"
+#include "regions.h"
+
+using std::pair;
+using std::vector;
+
+/**
+ * @class PathState
+ * @brief Incremental verifier that follows the solver's line as it grows
+ *
+ * The solver pushes a cell after marking it occupied on the grid and pops it
+ * before clearing it. Covered dots and triangle edge counts are adjusted per
+ * cell. Region labels only change when the line closes off part of the board:
+ * when it reaches a frame lattice point while already attached to the frame,
+ * or stops on an edge end whose other lattice point is on the frame or
+ * already on the line. The regions are then relabelled into a new level, and
+ * popping that cell drops the level.
+ * Check() then only has to read per-region counts.
+ *
+ * Grids with cancels fall back to Grid::IsValid.
+ */
+class PathState {
+public:
+  PathState();
+
+  /** @brief Start following g with an empty line drawn from start */
+  void Reset(Grid &g, pair<int, int> start);
+
+  /** @brief p was just marked occupied on the grid */
+  void Push(pair<int, int> p);
+
+  /** @brief Undo the last Push, before the cell is cleared on the grid */
+  void Pop();
+
+  /** @brief Same answer as grid.IsValid(start) for the current line */
+  bool Check();
+
+  /**
+   * @brief False if a region the line can no longer change already breaks
+   * a rule
+   *
+   * A region is final once no cell around its symbols is in open (the cells
+   * the rest of the line may still pass). Its blobs, stars, polyominos and
+   * triangles then stay as they are, so they can be checked now instead of
+   * at the end point. Always true with cancels.
+   */
+  bool FinalRegionsValid(const Bitboard &open);
+
+  /**
+   * @brief Could FinalRegionsValid fail now: is a triangle off or a region
+   * failing, or does a region need tiling to tell
+   */
+  bool MayFail();
+
+  /** @brief Did the last Push cut a region in two */
+  bool Closed() const { return !split_.empty() && split_.back(); }
+
+  /**
+   * @brief Does a triangle already touch the line more often than it says
+   *
+   * Counts only grow as the line does, so no longer line can fix it. Always
+   * false with cancels, which may erase the triangle.
+   */
+  bool Overfull() const { return !fallback_ && overfull_ > 0; }
+
+  /** @brief Region label of symbol cell p (both coordinates odd) */
+  int RegionOf(pair<int, int> p) const { return Top().label[grid_->Index(p)]; }
+
+  int RegionCount() const { return Top().regions; }
+
+  /** @brief The line so far, start first */
+  const vector<pair<int, int>> &Line() const { return path_; }
+
+  /** @brief Has the line reached the frame yet */
+  bool Touched() const { return touches_ > 0; }
+
+private:
+  // One labelling of the symbol cells with the per-region counts. colors,
+  // blobs and stars hold kPaletteSize entries per region.
+  struct Level {
+    vector<int> label;
+    int regions;
+    vector<int> colors; // every cell of the region, by palette color
+    vector<int> blobs;  // blobs, by palette color
+    vector<int> stars;  // stars, by palette color
+    vector<int> blocks; // polyominos
+    vector<signed char> valid; // RegionValid, -1 until asked
+  };
+
+  Grid *grid_;
+  pair<int, int> start_;
+  bool fallback_; // cancels present, defer to Grid::IsValid
+  bool regionrules_;
+
+  vector<Level> levels_; // levels_[0 .. depth_] are live
+  int depth_;
+  vector<pair<int, int>> path_;
+  vector<bool> split_; // did the matching Push open a level
+  int touches_;        // frame lattice points on the line
+
+  vector<int> sides_; // occupied pathable neighbours, per triangle cell
+  int uncovered_;     // dots not on the line
+  int unsatisfied_;   // triangles whose count is off
+  int overfull_;      // triangles whose count is past their number
+
+  Regions regions_;   // full labelling, see Label
+  vector<int> queue_; // flood fill scratch, see Split
+  vector<signed char> open_; // per region, see FinalRegionsValid
+
+  const Level &Top() const { return levels_[depth_]; }
+
+  bool OnFrame(pair<int, int> p) const;
+
+  // Does p, just pushed, touch a line cell other than the one before it.
+  bool Closes(pair<int, int> p) const;
+
+  void Label(Level &l);
+
+  void Split(const Level &from, Level &l, pair<int, int> e);
+
+  void Touch(pair<int, int> p, int d);
+
+  /** @brief Blobs, stars and polyominos of region r of the top level */
+  bool RegionValid(int r);
+
+  // Whether no cell of open touches region r, cached in open_.
+  bool Sealed(int r, const Bitboard &open);
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "blockgroup.h"
+
+using std::pair;
+using std::vector;
+
+/**
+ * @struct CellMask
+ * @brief A set of up to 64 * W cells of one region, one bit per cell
+ */
+template <int W> struct CellMask {
+  uint64_t w[W] = {};
+
+  void set(int k) { w[k >> 6] |= uint64_t(1) << (k & 63); }
+
+  void reset(int k) { w[k >> 6] &= ~(uint64_t(1) << (k & 63)); }
+
+  bool none() const {
+    for (int i = 0; i < W; i++)
+      if (w[i] != 0)
+        return false;
+    return true;
+  }
+
+  /** @brief True if every cell of m is also in this mask */
+  bool covers(const CellMask &m) const {
+    for (int i = 0; i < W; i++)
+      if ((w[i] & m.w[i]) != m.w[i])
+        return false;
+    return true;
+  }
+
+  /** @brief The lowest cell in the mask, which must not be empty */
+  int first() const {
+    int i = 0;
+    while (w[i] == 0)
+      i++;
+    return i * 64 + std::countr_zero(w[i]);
+  }
+
+  bool operator==(const CellMask &m) const {
+    return std::equal(w, w + W, m.w);
+  }
+
+  bool operator<(const CellMask &m) const {
+    return std::lexicographical_compare(w, w + W, m.w, m.w + W);
+  }
+
+  CellMask operator^(const CellMask &m) const {
+    CellMask res;
+    for (int i = 0; i < W; i++)
+      res.w[i] = w[i] ^ m.w[i];
+    return res;
+  }
+};
+
+/**
+ * @class Placements
+ * @brief Every way each piece fits in one region, as cell masks
+ *
+ * Build numbers the cells of the region by their rank in region.pairs and
+ * lists, for each piece in turn, every rotation (only the one for an oriented
+ * piece) at every offset that lands wholly inside the region. That is the
+ * same walk BlockGroup::dfsUtil makes, done once instead of at every level of
+ * the search, so Tile is left with nothing but mask tests.
+ */
+template <int W> class Placements {
+public:
+  using Mask = CellMask<W>;
+
+  static constexpr int kCells = 64 * W;
+
+  /**
+   * @brief Tabulate the placements of pieces in region
+   *
+   * @return false if the pieces cannot tile the region whatever Tile says:
+   * their sizes do not add up to the region's, or one fits nowhere
+   */
+  bool Build(BlockGroup &region, vector<BlockGroup> &pieces);
+
+  /** @brief Can the pieces, one placement each, cover the region exactly? */
+  bool Tile() { return Search(0, full_); }
+
+  /**
+   * @brief Same answer as Tile, found as an exact cover (Knuth's Algorithm X
+   * on masks instead of dancing links)
+   *
+   * Every cell has to be covered once and every piece used once. Each step
+   * picks the open cell with the fewest placements still fitting and tries
+   * only those, so a dead end shows up as a cell nothing can reach. Pieces
+   * with the same set of rotations are one column used count times, which
+   * spares the search every reordering of identical pieces.
+   */
+  bool Cover();
+
+private:
+  struct Option {
+    int kind;
+    Mask mask;
+  };
+
+  int size_; // cells in the region
+  Mask full_;
+  vector<vector<Mask>> table_; // per piece, in dfsUtil's order
+
+  vector<int> kinds_;     // per kind of piece, how many are left
+  vector<Option> cells_;  // the placements covering each cell, by cell
+  vector<int> begin_;     // where each cell's run starts in cells_
+
+  bool Search(size_t index, const Mask &left);
+
+  bool CoverSearch(const Mask &left);
+
+  /** @brief The distinct rotations of a piece, each moved to (0, 0) */
+  static vector<vector<pair<int, int>>> Shapes(BlockGroup &piece);
+};
+
+template <int W>
+vector<vector<pair<int, int>>> Placements<W>::Shapes(BlockGroup &piece) {
+  vector<vector<pair<int, int>>> res;
+  vector<pair<int, int>> shape(piece.pairs.begin(), piece.pairs.end());
+  for (int r = 0; r < (piece.oriented ? 1 : 4); r++) {
+    int x0 = INT_MAX, y0 = INT_MAX;
+    for (auto &p : shape) {
+      x0 = std::min(x0, p.first);
+      y0 = std::min(y0, p.second);
+    }
+    for (auto &p : shape)
+      p = {p.first - x0, p.second - y0};
+    std::sort(shape.begin(), shape.end());
+    // A symmetric piece repeats itself, and trying it twice changes nothing.
+    if (std::find(res.begin(), res.end(), shape) == res.end())
+      res.push_back(shape);
+    for (auto &p : shape)
+      p = {-1 * p.second, p.first}; // as BlockGroup::rotate(1)
+  }
+  return res;
+}
+
+template <int W>
+bool Placements<W>::Build(BlockGroup &region, vector<BlockGroup> &pieces) {
+  // Every piece is placed inside the region, subtractive ones included, just
+  // as dfsUtil does, so the pieces have to add up to the region exactly.
+  int total = 0;
+  for (auto &piece : pieces)
+    total += piece.n;
+  if (total != region.n || region.n > kCells)
+    return false;
+
+  int width = region.boundingbox.first;
+  int height = region.boundingbox.second;
+  vector<int> rank(width * height, -1);
+  full_ = Mask();
+  size_ = region.n;
+  int k = 0;
+  for (auto &p : region.pairs) {
+    rank[(p.first - region.bottomleft.first) * height + p.second -
+         region.bottomleft.second] = k;
+    full_.set(k++);
+  }
+
+  table_.assign(pieces.size(), vector<Mask>());
+  for (size_t i = 0; i < pieces.size(); i++) {
+    for (auto &shape : Shapes(pieces[i])) {
+      int w = 0, h = 0;
+      for (auto &p : shape) {
+        w = std::max(w, p.first + 1);
+        h = std::max(h, p.second + 1);
+      }
+      for (int dx = 0; dx + w <= width; dx++) {
+        for (int dy = 0; dy + h <= height; dy++) {
+          Mask m;
+          bool fits = true;
+          for (auto &p : shape) {
+            int r = rank[(p.first + dx) * height + p.second + dy];
+            if (r < 0) {
+              fits = false;
+              break;
+            }
+            m.set(r);
+          }
+          if (fits)
+            table_[i].push_back(m);
+        }
+      }
+    }
+    if (table_[i].empty())
+      return false;
+  }
+  return true;
+}
+
+template <int W>
+bool Placements<W>::Search(size_t index, const Mask &left) {
+  if (index >= table_.size())
+    return left.none();
+  for (const Mask &m : table_[index])
+    if (left.covers(m) && Search(index + 1, left ^ m))
+      return true;
+  return false;
+}
+
+template <int W> bool Placements<W>::Cover() {
+  // Kinds: pieces whose placement lists are the same set of masks. The first
+  // piece of each kind speaks for all of them below.
+  vector<int> kind(table_.size(), -1);
+  vector<size_t> first;
+  kinds_.clear();
+  for (size_t i = 0; i < table_.size(); i++) {
+    std::sort(table_[i].begin(), table_[i].end()); // Tile's order is lost
+    for (size_t j = 0; j < i && kind[i] < 0; j++)
+      if (table_[j] == table_[i])
+        kind[i] = kind[j];
+    if (kind[i] < 0) {
+      kind[i] = kinds_.size();
+      kinds_.push_back(0);
+      first.push_back(i);
+    }
+    kinds_[kind[i]]++;
+  }
+
+  // Bucket the placements by the cells they cover, as Regions::Finish does.
+  begin_.assign(size_ + 1, 0);
+  for (size_t i : first)
+    for (const Mask &m : table_[i])
+      for (Mask rest = m; !rest.none(); rest.reset(rest.first()))
+        begin_[rest.first() + 1]++;
+  for (int c = 0; c < size_; c++)
+    begin_[c + 1] += begin_[c];
+  cells_.resize(begin_[size_]);
+  vector<int> next(begin_.begin(), begin_.end() - 1);
+  for (size_t i : first)
+    for (const Mask &m : table_[i])
+      for (Mask rest = m; !rest.none(); rest.reset(rest.first()))
+        cells_[next[rest.first()]++] = {kind[i], m};
+
+  return CoverSearch(full_);
+}
+
+template <int W> bool Placements<W>::CoverSearch(const Mask &left) {
+  if (left.none())
+    return true; // the sizes add up, so every piece is used as well
+
+  int best = -1;
+  int fewest = INT_MAX;
+  for (Mask rest = left; !rest.none(); rest.reset(rest.first())) {
+    int c = rest.first();
+    int fit = 0;
+    for (int o = begin_[c]; o < begin_[c + 1] && fit < fewest; o++)
+      if (kinds_[cells_[o].kind] > 0 && left.covers(cells_[o].mask))
+        fit++;
+    if (fit < fewest) {
+      fewest = fit;
+      best = c;
+      if (fit == 0)
+        return false;
+    }
+  }
+
+  for (int o = begin_[best]; o < begin_[best + 1]; o++) {
+    const Option &opt = cells_[o];
+    if (kinds_[opt.kind] == 0 || !left.covers(opt.mask))
+      continue;
+    kinds_[opt.kind]--;
+    bool ok = CoverSearch(left ^ opt.mask);
+    kinds_[opt.kind]++;
+    if (ok)
+      return true;
+  }
+  return false;
+}
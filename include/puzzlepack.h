@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+// Puzzle pack files: many panels of one size, saved so they can be dealt
+// without running a generator.
+//
+//   PackHeader
+//   record 0, record 1, ...   (header.recordsize bytes each)
+//   PackEntry 0, 1, ...       (the index, at header.index)
+//
+// Every record has the same size, so panel i sits at records + i *
+// recordsize and is read where it lies, without parsing anything before
+// it. A record is the panel's cells, then maxblocks PackBlock slots for its
+// polyominos, then an optional solution. Integers are stored little endian,
+// the byte order of every machine the game runs on.
+
+inline constexpr char kPackMagic[8] = {'W', 'I', 'T', 'P', 'A', 'C', 'K', '1'};
+
+struct PackHeader {
+  char magic[8];
+  uint32_t count;      // records
+  uint16_t rows;       // of every panel, in grid cells (9 for 4x4)
+  uint16_t cols;
+  uint16_t maxblocks;  // block slots per record
+  uint16_t reserved;
+  uint32_t recordsize; // bytes
+  uint32_t blocks;     // offset of the block slots in a record
+  uint32_t solution;   // offset of the solution in a record
+  uint64_t records;    // offset of record 0 in the file
+  uint64_t index;      // offset of the index in the file
+};
+
+// One cell of a record, laid out as Grid's Cell with the path state in the
+// last byte.
+struct PackCell {
+  SymbolKind kind;
+  unsigned char color; // index into kPalette
+  unsigned char arg;   // triangle count
+  unsigned char flags; // kPackPath if a line may pass
+};
+
+inline constexpr unsigned char kPackPath = 1;
+
+// A polyomino: the cell it sits on, its flags, and its squares as a bitmap
+// over an 8x8 box ((x - x0) * 8 + y - y0 for a square (x, y)).
+struct PackBlock {
+  uint8_t row;
+  uint8_t col;
+  uint8_t flags; // kPackOriented | kPackSub
+  uint8_t used;  // 1 if the slot holds a polyomino
+  int8_t x0;
+  int8_t y0;
+  uint16_t reserved;
+  uint64_t mask;
+};
+
+inline constexpr uint8_t kPackOriented = 1;
+inline constexpr uint8_t kPackSub = 2;
+
+// The stored line: its first cell, its length in cells, then a 2-bit step
+// for each cell after the first (Solver's dx / dy order), four to a byte.
+struct PackSolution {
+  uint16_t start;  // row * cols + col
+  uint16_t length; // 0 if the record stores no solution
+};
+
+// What the index says about a panel, readable without touching its record.
+struct PackEntry {
+  uint8_t family;     // a PuzzleFamily, or 0xFF if unknown
+  uint8_t reserved[3];
+  uint32_t solutions; // counted by whoever wrote the pack, 0 if not
+  uint32_t nodes;     // Curator's difficulty, 0 if not rated
+};
+
+static_assert(sizeof(PackCell) == sizeof(Cell), "PackCell mirrors Cell");
+static_assert(sizeof(PackHeader) == 48, "PackHeader layout");
+static_assert(sizeof(PackBlock) == 16, "PackBlock layout");
+static_assert(sizeof(PackEntry) == 12, "PackEntry layout");
+
+/**
+ * @class PackPanel
+ * @brief One record of an open pack, read in place
+ *
+ * Holds pointers into the pack's mapping, so it is only good while the pack
+ * stays open. Cells can be read straight off the record; ToGrid builds a
+ * Grid for the solver and the game. A panel past the end of the pack is
+ * empty: no record, an empty Grid and no solution.
+ */
+class PackPanel {
+public:
+  const PackHeader *header_ = nullptr; // null if empty
+  const PackCell *cells_ = nullptr;    // rows * cols of them, row by row
+  const PackBlock *blocks_ = nullptr;  // maxblocks slots
+  const PackSolution *solution_ = nullptr;
+  const PackEntry *entry_ = nullptr;
+
+  bool Empty() const { return header_ == nullptr; }
+
+  const PackCell &At(int row, int col) const {
+    return cells_[row * header_->cols + col];
+  }
+
+  Grid ToGrid() const;
+
+  /**
+   * @brief The stored line, start to end, empty if there is none or it does
+   * not fit the panel
+   */
+  vector<pair<int, int>> Solution() const;
+};
+
+/**
+ * @class PuzzlePack
+ * @brief A pack file mapped into memory
+ *
+ * Open maps the file and checks the header, nothing more, so a pack of
+ * millions of panels opens as fast as a small one. Panel(i) is pointer
+ * arithmetic.
+ */
+class PuzzlePack {
+public:
+  PuzzlePack();
+
+  ~PuzzlePack();
+
+  PuzzlePack(const PuzzlePack &) = delete;
+  PuzzlePack &operator=(const PuzzlePack &) = delete;
+
+  /** @brief Map the pack at path. False if it is missing or not a pack. */
+  bool Open(const string &path);
+
+  void Close();
+
+  size_t Size() const { return header_ ? header_->count : 0; }
+
+  int Rows() const { return header_->rows; }
+
+  int Cols() const { return header_->cols; }
+
+  /** @brief Panel i, empty unless i < Size() */
+  PackPanel Panel(size_t i) const;
+
+  /** @brief What the index says about panel i, for i < Size() */
+  const PackEntry &Entry(size_t i) const { return index_[i]; }
+
+private:
+  const unsigned char *data_;
+  size_t size_;
+  const PackHeader *header_;
+  const PackEntry *index_;
+  vector<unsigned char> copy_; // the file, where it cannot be mapped
+};
+
+/**
+ * @class PackWriter
+ * @brief Writes a pack one panel at a time
+ *
+ * Records go to the file as they are added. The index is kept in memory
+ * (12 bytes a panel) and written by Close, which also fills in the header.
+ */
+class PackWriter {
+public:
+  PackWriter();
+
+  ~PackWriter();
+
+  PackWriter(const PackWriter &) = delete;
+  PackWriter &operator=(const PackWriter &) = delete;
+
+  /**
+   * @brief Start a pack at path for rows x cols panels (in grid cells) with
+   * up to maxblocks polyominos each
+   *
+   * With maxblocks > 0, rows and cols are at most 255 (a PackBlock holds
+   * its cell in a byte each).
+   */
+  bool Open(const string &path, int rows, int cols, int maxblocks = 8);
+
+  /**
+   * @brief Append g, with solution (start to end, may be empty)
+   *
+   * @return false if g does not fit the pack: another size, more
+   * polyominos than maxblocks or one wider than 8 squares
+   */
+  bool Add(const Grid &g, const PackEntry &entry,
+           const vector<pair<int, int>> &solution);
+
+  /** @brief Write the index and header. False if any write failed. */
+  bool Close();
+
+  size_t Size() const { return entries_.size(); }
+
+private:
+  std::FILE *file_;
+  PackHeader header_;
+  vector<PackEntry> entries_;
+  vector<unsigned char> record_;
+  bool ok_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "grid.h"
+#include "randgrid.h"
+#include "spscqueue.h"
+
+/**
+ * @class PuzzleQueue
+ * @brief Panels made ahead of time on a thread of their own
+ *
+ * Keeps up to kDepth solvable panels ready for every enabled family, so the
+ * game can deal one without running a generator (and its retries) between
+ * two frames. Each family has its own SpscQueue: the producer thread is the
+ * only one pushing and the game thread the only one popping.
+ */
+class PuzzleQueue {
+public:
+  static const size_t kDepth = 4;
+
+  PuzzleQueue();
+
+  ~PuzzleQueue();
+
+  /** @brief Start or stop making panels of family. All start enabled. */
+  void Enable(PuzzleFamily family, bool on);
+
+  /**
+   * @brief Take a ready panel of family into g
+   *
+   * @return false if there is none yet (the caller makes its own)
+   */
+  bool TryPop(PuzzleFamily family, Grid &g);
+
+private:
+  RandGrid generator_; // the producer's own, RandGrid is not thread safe
+  SpscQueue<Grid, kDepth> ready_[kPuzzleFamilies];
+  std::atomic<bool> enabled_[kPuzzleFamilies];
+
+  // The producer sleeps on wake_ while every enabled queue is full.
+  std::mutex lock_;
+  std::condition_variable wake_;
+  bool stop_;
+  std::thread producer_;
+
+  void Run();
+
+  /** @brief Wake the producer, there may be a queue to fill */
+  void Notify();
+};
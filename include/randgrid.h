@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <ctime>
 #include <iostream>
 #include <map>
@@ -11,6 +12,8 @@
 #include <vector>
 
 #include "grid.h"
+#include "pathmask.h"
+#include "regions.h"
 
 using std::cout;
 using std::endl;
@@ -29,12 +32,26 @@ using std::vector;
 // Maximum number of attempts to generate path before giving up.
 #define NUM_ATTEMPTS 256
 
+// The puzzle families the game deals, see RandGrid::randFamily.
+enum PuzzleFamily {
+  kChallengeBlocks,
+  kBlobs3,
+  kChallengeStars,
+  kTriangles,
+  kBlobs2,
+  kDots,
+  kStars,
+  kMaze,
+
+  kPuzzleFamilies
+};
+
 // not really feeling like putting splitting header + implementation this time
 // ... might do that later ...
 
 /**
  * @class RandGrid
- * @brief generates 4x4 (internally 9x9) puzzle panel grids
+ * @brief generates puzzle panel grids, 4x4 (internally 9x9) unless resized
  *
  */
 class RandGrid {
@@ -42,12 +59,17 @@ public:
   vector<int> dx;
   vector<int> dy;
 
-  vector<set<pair<int, int>>> possiblePaths;
+  PathArena possiblePaths;
   vector<set<pair<int, int>>> gridRegions;
 
   pair<int, int> start;
   pair<int, int> end;
 
+  // Size of the grid in cells: twice the panel's plus one, so 9x9 for the
+  // 4x4 panels the game uses. See resize.
+  int rows;
+  int cols;
+
   mt19937 gen;
 
   // fix random_shuffle
@@ -56,6 +78,9 @@ public:
 
   bool singlepath;
 
+  // Walks randomPath draws to pick each path from
+  int pathSamples;
+
   vector<EntityColor> colors;
 
   RandGrid() {
@@ -64,11 +89,14 @@ public:
     dy = vector<int>({00, 01, 00, -1});
     possiblePaths.clear();
 
+    rows = 9;
+    cols = 9;
     start = {8, 0}; // The grid is still double in size however points with both
                     // coordinates odd cannot be traversed.
     end = {0, 8};
 
     singlepath = false;
+    pathSamples = 16;
 
     colors = vector<EntityColor>({EntityColor::kRED, EntityColor::kGREEN,
                                   EntityColor::kBLUE, EntityColor::kYELLOW,
@@ -84,10 +112,13 @@ public:
     dy = vector<int>({00, 01, 00, -1});
     possiblePaths.clear();
 
+    rows = 9;
+    cols = 9;
     start = a;
     end = b;
 
     singlepath = false;
+    pathSamples = 16;
 
     colors = vector<EntityColor>({EntityColor::kRED, EntityColor::kGREEN,
                                   EntityColor::kBLUE, EntityColor::kYELLOW,
@@ -107,7 +138,17 @@ public:
   void reset(pair<int, int> a, pair<int, int> b) {
     start = a;
     end = b;
-    pathfind();
+    possiblePaths.clear(); // paths from the old end points
+  }
+
+  /**
+   * @brief Make r x c panels from now on, starting at the bottom left corner
+   * and ending at the top right one
+   */
+  void resize(int r, int c) {
+    rows = 2 * r + 1;
+    cols = 2 * c + 1;
+    reset({rows - 1, 0}, {0, cols - 1});
   }
 
   int randint(
@@ -132,17 +173,18 @@ public:
 
     vector<vector<std::shared_ptr<Entity>>> v =
         vector<vector<std::shared_ptr<Entity>>>(
-            9, vector<std::shared_ptr<Entity>>(9));
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+            rows, vector<std::shared_ptr<Entity>>(cols));
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
       }
     }
 
     set<pair<int, int>> ps;
     set<pair<int, int>> ps2;
-    while (ps.size() < 8) {
-      pair<int, int> p = make_pair(randint(4), randint(4));
+    size_t stars = std::min(8, (rows / 2) * (cols / 2));
+    while (ps.size() < stars) {
+      pair<int, int> p = make_pair(randint(rows / 2), randint(cols / 2));
       ps.insert(p);
     }
 
@@ -167,18 +209,21 @@ public:
     return grid;
   }
 
-  // A hamiltonian path has 25 vertices and thus 24 edges.
-  // Theree are 20 + 20 = 40 edges available.
+  // A hamiltonian path on a 4x4 panel has 25 vertices and thus 24 edges.
+  // Theree are 20 + 20 = 40 edges available. Bigger panels get as many cuts
+  // per edge.
 
   Grid randMaze() { // Generates a grid containing 12 cutoffs in (1<<16)
                     // attempts to get the edges.
-    set<pair<int, int>> path = possiblePaths[randint(possiblePaths.size())];
+    PathMask path = randomPath();
+    int edges = (rows / 2) * (cols / 2 + 1) + (cols / 2) * (rows / 2 + 1);
+    int numCuts = 12 * edges / 40;
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -188,10 +233,10 @@ public:
     set<pair<int, int>> cuts;
 
     int count = 0;
-    while (cuts.size() < 12 && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+    while ((int)(cuts.size()) < numCuts && count < (1 << 16)) {
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         cuts.insert({x, y});
@@ -215,20 +260,18 @@ public:
 
   int blobPathScale(int x) { return (12 + randint(8)) << 1; }
 
-  int minRegionSize(int x) { return 16 / x; }
+  int minRegionSize(int x) { return (rows / 2) * (cols / 2) / x; }
 
   Grid randBlobs(int numBlobs, int numCols,
                  int numCuts) { // Generates a grid containing up to numBlobs
                                 // blobs. This grid also has up to numCuts cuts.
 
-    set<pair<int, int>> path = possiblePaths[randint(possiblePaths.size())];
+    PathMask path = randomPath();
     getRegions(path);
     int attempts = 0;
     while (attempts < NUM_ATTEMPTS) {
       attempts++;
-      if (singlepath)
-        pathfind();
-      path = possiblePaths[randint(possiblePaths.size())];
+      path = randomPath();
       getRegions(path);
 
       if ((int)(gridRegions.size()) < blobRegionScale(numCols))
@@ -246,10 +289,10 @@ public:
     }
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -260,9 +303,9 @@ public:
 
     int count = 0;
     while ((int)(things.size()) < numCuts && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         things.insert({x, y});
@@ -298,8 +341,8 @@ public:
             NUM_ATTEMPTS) { // Attempt to collect dots evenly from all regions
       int subcount = 0;
       while (subcount < NUM_ATTEMPTS) {
-        int x = 1 + 2 * randint(4);
-        int y = 1 + 2 * randint(4);
+        int x = 1 + 2 * randint(rows / 2);
+        int y = 1 + 2 * randint(cols / 2);
         if (gridRegions[theIndex].find({x, y}) != gridRegions[theIndex].end()) {
           things.insert({x, y});
           break;
@@ -311,8 +354,8 @@ public:
     count = 0;
 
     while ((int)(things.size()) < numBlobs && count < NUM_ATTEMPTS) {
-      int x = 1 + 2 * randint(4);
-      int y = 1 + 2 * randint(4);
+      int x = 1 + 2 * randint(rows / 2);
+      int y = 1 + 2 * randint(cols / 2);
 
       things.insert({x, y});
 
@@ -341,13 +384,13 @@ public:
   Grid randTriangles(int numTriangles,
                      int numCuts) { // Generates a grid with up to numTriangles
                                     // triangles and up to numCuts cuts
-    set<pair<int, int>> path = possiblePaths[randint(possiblePaths.size())];
+    PathMask path = randomPath();
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -358,9 +401,9 @@ public:
 
     int count = 0;
     while ((int)(things.size()) < numCuts && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         things.insert({x, y});
@@ -381,8 +424,8 @@ public:
     count = 0;
 
     while ((int)(things.size()) < numTriangles && count < (1 << 16)) {
-      int x = 1 + 2 * randint(4);
-      int y = 1 + 2 * randint(4);
+      int x = 1 + 2 * randint(rows / 2);
+      int y = 1 + 2 * randint(cols / 2);
 
       int pathcount = 0;
       for (int i = 0; i < 4; i++) {
@@ -403,7 +446,7 @@ public:
       for (int d = 0; d < 4; d++) {
         int xp = i.first + dx[d];
         int yp = i.second + dy[d];
-        if (path.find({xp, yp}) != path.end())
+        if (path.contains({xp, yp}))
           count++;
       }
       if (count > 0)
@@ -416,13 +459,13 @@ public:
 
   Grid randDots(int numDots, int numCuts) { // Generates a grid with up to
                                             // numDots dots and numCuts cuts
-    set<pair<int, int>> path = possiblePaths[randint(possiblePaths.size())];
+    PathMask path = randomPath();
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -433,9 +476,9 @@ public:
 
     int count = 0;
     while ((int)(things.size()) < numCuts && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         things.insert({x, y});
@@ -475,12 +518,10 @@ public:
                                  // partitioned into blocks.
     // The number of subregions scales with the size of the chosen region.
     // There will also be up to numCuts cuts
-    set<pair<int, int>> path;
+    PathMask path;
     int attempts = 0;
     while (attempts < NUM_ATTEMPTS) { // At most 2 blocks per region
-      if (singlepath)
-        pathfind();
-      path = possiblePaths[randint(possiblePaths.size())];
+      path = randomPath();
       getRegions(path);
 
       if (gridRegions.size() >= BLOCKS_REGIONS)
@@ -489,10 +530,10 @@ public:
     }
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -516,9 +557,9 @@ public:
 
     int count = 0;
     while ((int)(things.size()) < numCuts && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         things.insert({x, y});
@@ -629,12 +670,10 @@ public:
     // Get 2 colors
     std::shuffle(colors.begin(), colors.end(), g);
 
-    set<pair<int, int>> path;
+    PathMask path;
     int attempts = 0;
     while (attempts < NUM_ATTEMPTS) { // At most 2 blocks per region
-      if (singlepath)
-        pathfind();
-      path = possiblePaths[randint(possiblePaths.size())];
+      path = randomPath();
       getRegions(path);
 
       if (gridRegions.size() > BLOCKS_REGIONS)
@@ -643,10 +682,10 @@ public:
     }
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -670,9 +709,9 @@ public:
 
     int count = 0;
     while ((int)(things.size()) < numCuts && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         things.insert({x, y});
@@ -814,13 +853,11 @@ public:
     // Get 2 colors
     std::shuffle(colors.begin(), colors.end(), g);
 
-    set<pair<int, int>> path;
+    PathMask path;
     int attempts = 0;
     while (attempts < NUM_ATTEMPTS) {
       attempts++;
-      if (singlepath)
-        pathfind();
-      path = possiblePaths[randint(possiblePaths.size())];
+      path = randomPath();
       getRegions(path);
 
       if (gridRegions.size() <= STARS_REGIONS)
@@ -841,10 +878,10 @@ public:
     }
 
     vector<vector<std::shared_ptr<Entity>>> v(
-        9, vector<std::shared_ptr<Entity>>(9));
+        rows, vector<std::shared_ptr<Entity>>(cols));
 
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
         v[i][j] = std::shared_ptr<Entity>(new Entity());
         if (i % 2 == 0 || j % 2 == 0)
           v[i][j]->is_path_ = true;
@@ -855,9 +892,9 @@ public:
 
     int count = 0;
     while ((int)(cuts.size()) < numCuts && count < (1 << 16)) {
-      int x = randint(9);
-      int y = randint(9);
-      if (path.find({x, y}) != path.end())
+      int x = randint(rows);
+      int y = randint(cols);
+      if (path.contains({x, y}))
         continue;
       if ((x % 2 == 0) ^ (y % 2 == 0))
         cuts.insert({x, y});
@@ -933,58 +970,151 @@ public:
     return Grid(v);
   }
 
+  /** @brief A panel of family, made with the arguments the game uses */
+  Grid randFamily(PuzzleFamily family) {
+    switch (family) {
+    case kChallengeBlocks:
+      return randChallengeBlocks(2);
+    case kBlobs3:
+      return randBlobs(9, 3, 2);
+    case kChallengeStars:
+      return randChallengeStars(2);
+    case kTriangles:
+      return randTriangles(10, 2);
+    case kBlobs2:
+      return randBlobs(8, 2, 4);
+    case kDots:
+      return randDots(4, 2);
+    case kStars:
+      return randStars();
+    default:
+      return randMaze();
+    }
+  }
+
   // Get all regions for a path
 
-  void getRegions(set<pair<int, int>> path) {
+  void getRegions(const PathMask &path) {
     gridRegions.clear();
 
-    set<pair<int, int>> vis;
-    set<pair<int, int>> area;
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
-        pair<int, int> src = {i, j};
-        if (vis.find(src) != vis.end())
-          continue;
-        if (path.find(src) != path.end())
-          continue;
-        set<pair<int, int>> area;
-
-        queue<pair<int, int>> q;
-        q.push(src);
-        while (q.size() > 0) {
-          pair<int, int> now = q.front();
-          q.pop();
-
-          for (int d = 0; d < 4; d++) {
-            pair<int, int> next = {now.first + dx[d], now.second + dy[d]};
-            if (!inside(next))
-              continue;
-            if (path.find(next) != path.end())
-              continue;
-            if (vis.find(next) != vis.end())
-              continue;
-
-            area.insert(next);
-            vis.insert(next);
-            q.push(next);
-          }
-        }
-
-        gridRegions.push_back(area);
-      }
+    Bitboard blocked(rows * cols);
+    for (auto i : path)
+      if (inside(i))
+        blocked.set(i.first * cols + i.second);
+
+    Regions regions;
+    regions.LabelCells(rows, cols, blocked);
+
+    for (int r = 0; r < regions.count_; r++) {
+      set<pair<int, int>> area;
+      // A cell walled in on all four sides has always come out as an empty
+      // region here; the generators are tuned around that.
+      if (regions.Size(r) > 1)
+        for (const int *k = regions.Begin(r); k != regions.End(r); k++)
+          area.insert({*k / cols, *k % cols});
+      gridRegions.push_back(area);
     }
 
     // cout << gridRegions.size() << " REGIONS FOUND" << endl;
   }
 
-  // Get all paths.
+  // Random paths.
+
+  /**
+   * @brief A random start to end path, drawn on demand
+   *
+   * A walk from start that only steps where end can still be reached never
+   * gets stuck, but it favours some paths over others: a path comes out with
+   * probability 1 / (product of the choices along the way). randomPath draws
+   * pathSamples such walks and keeps one with probability proportional to
+   * that product (sampling importance resampling). With 16 walks the result
+   * is close to uniform over all paths, like picking one from possiblePaths,
+   * without listing them first.
+   *
+   * @return the cells of the path, empty if end cannot be reached
+   */
+  PathMask randomPath() {
+    vector<PathMask> walks(pathSamples);
+    vector<double> weights(pathSamples);
+    double top = -INFINITY;
+    for (int i = 0; i < pathSamples; i++) {
+      walks[i] = randomWalk(weights[i]);
+      top = std::max(top, weights[i]);
+    }
+    if (top == -INFINITY)
+      return PathMask(rows, cols);
+
+    double total = 0;
+    for (auto &w : weights)
+      total += exp(w - top);
+    double pick = gen() / 4294967296.0 * total;
+    for (int i = 0; i < pathSamples; i++) {
+      pick -= exp(weights[i] - top);
+      if (pick < 0)
+        return walks[i];
+    }
+    return walks[pathSamples - 1];
+  }
+
+  /**
+   * @brief One walk for randomPath
+   *
+   * @param logweight (set to the log of the product of the choices made,
+   * -INFINITY if the walk failed)
+   */
+  PathMask randomWalk(double &logweight) {
+    Bitboard blocked(rows * cols);
+    for (int i = 1; i < rows; i += 2)
+      for (int j = 1; j < cols; j += 2)
+        blocked.set(i * cols + j);
+
+    PathMask path(rows, cols);
+    pair<int, int> now = start;
+    blocked.set(now.first * cols + now.second);
+    path.insert(now);
+    logweight = 0;
+
+    Regions regions;
+    vector<pair<int, int>> free, moves;
+    while (now != end) {
+      free.clear();
+      for (int i = 0; i < 4; i++) {
+        pair<int, int> next = {now.first + dx[i], now.second + dy[i]};
+        if (inside(next) && !blocked.test(next.first * cols + next.second))
+          free.push_back(next);
+      }
+      // Only look ahead when there is a choice (never on an edge).
+      moves.clear();
+      if (free.size() == 1) {
+        moves = free;
+      } else {
+        regions.LabelCells(rows, cols, blocked);
+        for (auto next : free)
+          if (regions.At(next) == regions.At(end))
+            moves.push_back(next);
+      }
+      if (moves.empty()) {
+        logweight = -INFINITY;
+        return PathMask(rows, cols);
+      }
+
+      logweight += log((double)moves.size());
+      now = moves[randint(moves.size())];
+      blocked.set(now.first * cols + now.second);
+      path.insert(now);
+    }
+    return path;
+  }
+
+  // Get all paths. The generators draw from randomPath instead; the full
+  // list is only for looking at (disp, visualize).
 
   std::map<pair<int, int>, pair<int, int>> parent;
 
   bool inside(pair<int, int> x) {
     if (x.first < 0 || x.second < 0)
       return false;
-    if (x.first >= 9 || x.second >= 9)
+    if (x.first >= rows || x.second >= cols)
       return false;
     return true;
   }
@@ -994,7 +1124,7 @@ public:
       return;
     if (src == end) {
       parent.insert({src, prev});
-      set<pair<int, int>> res;
+      PathMask res(rows, cols);
       pair<int, int> thing = make_pair(src.first, src.second);
       if (parent.find(thing) == parent.end())
         return;
@@ -1043,10 +1173,11 @@ public:
   void visualize(int x) {
     if (x < 0 || (size_t)x >= possiblePaths.size())
       return;
-    getRegions(possiblePaths[x]);
-    for (int i = 0; i < 9; i++) {
-      for (int j = 0; j < 9; j++) {
-        if (possiblePaths[x].find({i, j}) != possiblePaths[x].end())
+    PathMask path = possiblePaths[x];
+    getRegions(path);
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
+        if (path.contains({i, j}))
           cout << "#";
         else {
           bool bad = true;
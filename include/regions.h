@@ -0,0 +1,66 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "bitboard.h"
+
+using std::pair;
+using std::vector;
+
+/**
+ * @class Regions
+ * @brief Connected regions of a grid, labelled in one pass
+ *
+ * A scanline union-find: every cell is joined with its left and upper
+ * neighbour when nothing blocks the way, then the roots are numbered in
+ * row-major order. Region 0 is the one holding the first cell, the same order
+ * a flood fill started from each unvisited cell in turn would find them.
+ *
+ * After labelling, label_ maps a flat cell index (row * n + column, as in
+ * Grid::Index) to its region, or -1 for cells that belong to none. The cells
+ * of region r are cells_[begin_[r]] .. cells_[begin_[r + 1] - 1], in
+ * row-major order.
+ */
+class Regions {
+public:
+  int m_;
+  int n_;
+  int count_;
+  vector<int> label_;
+  vector<int> begin_;
+  vector<int> cells_;
+
+  Regions();
+
+  /**
+   * @brief Every cell that is not blocked, joined to its four neighbours
+   * that are not blocked either
+   */
+  void LabelCells(int m, int n, const Bitboard &blocked);
+
+  /**
+   * @brief The symbol cells (both coordinates odd), joined two steps apart
+   * when the edge between them is not blocked
+   */
+  void LabelLattice(int m, int n, const Bitboard &blocked);
+
+  int At(pair<int, int> p) const { return label_[p.first * n_ + p.second]; }
+
+  int Size(int r) const { return begin_[r + 1] - begin_[r]; }
+
+  const int *Begin(int r) const { return cells_.data() + begin_[r]; }
+
+  const int *End(int r) const { return cells_.data() + begin_[r + 1]; }
+
+private:
+  vector<int> parent_; // -1 for cells outside every region
+
+  void Start(int m, int n);
+
+  int Find(int x);
+
+  void Union(int a, int b);
+
+  void Finish();
+};
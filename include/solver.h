@@ -1,11 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <random>
 #include <vector>
 
 #include "grid.h"
+#include "pathstate.h"
+#include "threadpool.h"
 #include "util.h"
 
 using std::cout;
@@ -20,22 +26,184 @@ public:
 
   int callstopath_;
   vector<pair<int, int>> solution_;
-  std::map<pair<int, int>, pair<int, int>> vis_;
+
+  // The depth-first search, as an explicit stack: one frame per cell of the
+  // line after the start's. The frame below a cell's is its parent, and the
+  // line's cells are exactly the occupied ones on grid_, so neither needs a
+  // structure of its own. stack_ keeps its capacity between searches.
+  struct Frame {
+    pair<int, int> cell;
+    int offset; // first direction tried, see FirstDirection
+    int tried;  // directions tried so far
+  };
+  vector<Frame> stack_;
+
+  // Reachability prune: back out of a cell once no end point can be reached
+  // from it through free path cells. One flood fill over the bitboards per
+  // node, with scratch boards sized by Masks so it allocates nothing.
+  bool reachprune_;
+  Bitboard endmask_;   // end points
+  Bitboard notfirst_;  // cells not in the first column
+  Bitboard notlast_;   // cells not in the last column
+  Bitboard reach_;     // flood fill scratch
+  Bitboard next_;
+
+  // Dot prune: back out of a cell once some dot not on the line yet cannot
+  // be covered on the way to an end. A dot the head cannot reach is lost,
+  // and so is one behind a cut vertex of the free cells with no end point
+  // behind it too: the line could go in through that cell but never come
+  // back out. Found with one lowlink (Tarjan) search from the head, only
+  // while dots are left. Off with cancels, which may erase a dot.
+  bool dotprune_;
+  Bitboard dotmask_; // empty with cancels
+  int stamp_;             // marks cells seen by the current search
+  vector<int> seen_;      // per cell: stamp_ once seen
+  vector<int> order_;     // per cell: discovery time
+  vector<int> low_;       // per cell: lowest time reachable below it
+  vector<int> dotsbelow_; // per cell: dots in its subtree
+  vector<int> endsbelow_; // per cell: end points in its subtree
+  vector<pair<int, int>> dfs_; // (cell, next direction) stack
+
+  // Closure prune: after drawing a cell, check every region the line can no
+  // longer reach (PathState::FinalRegionsValid). A region becomes final
+  // when the line seals off the free cells around it, which without cuts
+  // only happens as PathState splits a region. A triangle touched too often
+  // fails at once.
+  bool closeprune_;
+  bool cuts_; // some lattice point or edge no line may pass
+
+  // Triangle propagation: for every triangle, the sides the line uses and
+  // the sides it could still use. Back out once a triangle has too many or
+  // can no longer get enough. When every side a triangle could still get is
+  // needed and one of them starts at the head, the line takes it at once:
+  // it cannot come back for it later. Off with cancels, which may erase a
+  // triangle.
+  bool triprune_;
+  vector<pair<int, int>> tris_; // triangle cells, empty with cancels
 
   pair<int, int> origin_;
 
   Grid grid_;
 
+  // Follows the line drawn in grid_ so reaching an end point is a cheap check
+  PathState state_;
+
+  // Parallel solving. With threads_ > 1, Solve() walks the first splitdepth_
+  // cells of every line itself and hands each subtree below to a pool of
+  // threads_ workers, each with its own copy of the grid. The first worker to
+  // find a solution stops the rest, so which solution comes back (and the
+  // node count) depends on timing even with a seed.
+  int threads_;
+  int splitdepth_;
+
+  // Search order. Every node tries the four directions in turn, starting
+  // from one drawn from rng_. Each search reseeds rng_ with seed_, so the
+  // same panel always takes the same path through the tree (and the same
+  // callstopath_). A seed of 0 takes one from the clock instead. With
+  // randomorder_ off, every node starts from direction 0.
+  unsigned seed_;
+  bool randomorder_;
+  std::mt19937 rng_;
+
+  std::atomic<bool> *stop_; // set when another worker found a solution
+  std::shared_ptr<ThreadPool> pool_;
+
+  // What Path does with a valid line: keep the first one (Solve), count them
+  // (CountSolutions) or hand each one to each_ (ForEachSolution).
+  enum Mode { kFirst, kCount, kEach };
+  Mode mode_;
+  long long found_; // valid lines seen so far
+  long long limit_; // stop after this many, 0 for no limit
+  std::function<bool(const vector<pair<int, int>> &)> each_;
+  bool done_; // stop searching
+
   Solver();
 
   Solver(Grid &g);
 
   void Set(Grid &g);
 
-  void Path(pair<int, int> src, pair<int, int> prev);
+  /**
+   * @brief The ValidateRegion prune: true if no line through src can work
+   *
+   * Only used with closeprune_ off.
+   */
+  bool Prune(pair<int, int> src);
+
+  /**
+   * @brief Fill reach_ with the free cells reachable from src, stopping at
+   * the first end point if stop. True if an end point was reached.
+   */
+  bool Flood(pair<int, int> src, bool stop);
+
+  /** @brief The closure prune, for the cell just drawn: true if it fails */
+  bool Closes();
+
+  /** @brief The reachability prune: true if no end is reachable from src */
+  bool Sealed(pair<int, int> src);
+
+  /** @brief The dot prune: true if some dot can no longer be covered */
+  bool Stranded(pair<int, int> src);
+
+  /**
+   * @brief The triangle prune, for head just drawn: true if some triangle
+   * can no longer be satisfied
+   *
+   * @param forced (the direction the line must take from head, or -1)
+   */
+  bool Starved(pair<int, int> head, int &forced);
+
+  /** @brief Could the line still pass side e, with head the last cell drawn */
+  bool Live(pair<int, int> e, pair<int, int> head);
+
+  /** @brief Size the reachability and dot prunes' scratch for grid_ */
+  void Masks();
+
+  /** @brief Search every line that continues the current one through src */
+  void Path(pair<int, int> src);
+
+  /**
+   * @brief Visit src: check the line if src is an end point, otherwise draw
+   * it and push its frame unless Prune rules it out
+   */
+  void Enter(pair<int, int> src);
+
+  void Split(pair<int, int> src, vector<pair<int, int>> &prefix,
+             vector<vector<pair<int, int>>> &tasks);
+
+  /** @brief First direction to try at the next node */
+  int FirstDirection() { return randomorder_ ? rng_() % 4 : 0; }
+
+  /** @brief Reseed rng_ for a new search, see seed_ */
+  void Seed();
+
+  /** @brief Draw prefix on grid_ as if Path had walked it */
+  void Replay(const vector<pair<int, int>> &prefix);
 
   vector<pair<int, int>> Solve();
 
+  vector<pair<int, int>> SolveParallel();
+
+  /**
+   * @brief Count the solutions, stopping early once limit are found
+   *
+   * @param limit (0 counts them all)
+   * @return min(limit, number of solutions)
+   */
+  long long CountSolutions(long long limit);
+
+  /**
+   * @brief Call f with every solution (start to end) in search order
+   *
+   * @param f (returns false to stop the search)
+   * @return number of solutions passed to f
+   */
+  long long ForEachSolution(
+      std::function<bool(const vector<pair<int, int>> &)> f);
+
+  /** @brief Run Path from every start in turn, in the current mode */
+  void Search();
+
   string ToString();
 
   void Display();
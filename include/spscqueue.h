@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @class SpscQueue
+ * @brief A bounded queue for exactly one producer thread and one consumer
+ * thread, without locks
+ *
+ * The items live in a ring of N slots. head_ and tail_ only ever grow, the
+ * producer alone writes tail_ and the consumer alone writes head_, so each
+ * side needs just an acquire load of the other's counter to know which
+ * slots it owns. N must be a power of two.
+ */
+template <typename T, size_t N> class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  SpscQueue() : head_(0), tail_(0) {}
+
+  /** @brief Add item at the back. Producer only. */
+  bool TryPush(T &&item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == N)
+      return false;
+    slots_[tail & (N - 1)] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Take the item at the front into item. Consumer only. */
+  bool TryPop(T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    item = std::move(slots_[head & (N - 1)]);
+    slots_[head & (N - 1)] = T(); // drop what the slot held now, not later
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Items queued. Exact only on the producer or consumer thread. */
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  bool Full() const { return Size() == N; }
+
+private:
+  T slots_[N];
+  // Apart, so the two threads do not fight over one cache line.
+  alignas(64) std::atomic<size_t> head_; // next slot to pop
+  alignas(64) std::atomic<size_t> tail_; // next slot to push
+};
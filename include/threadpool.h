@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads with work stealing
+ *
+ * Every worker owns a deque. A task submitted from inside a worker goes on
+ * that worker's deque, and any other task is handed out round-robin. Workers
+ * take from the back of their own deque first (the newest task, still warm
+ * in cache). When that is empty they steal from the front of the others (the
+ * oldest task, usually the biggest piece of work left).
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(int threads);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Submit(std::function<void()> task);
+
+  /** @brief Block until every submitted task has finished */
+  void Wait();
+
+  int Size() const { return (int)workers_.size(); }
+
+  /**
+   * @brief Index of the calling worker in its own pool, -1 off any pool
+   *
+   * A task always runs on a worker of the pool it was submitted to, so
+   * inside a task this is an index into that pool.
+   */
+  static int WorkerIndex();
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  vector<std::thread> workers_;
+  vector<std::unique_ptr<Queue>> queues_;
+
+  std::mutex lock_; // guards the sleeping and waiting below
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::atomic<int> pending_; // submitted, not finished
+  std::atomic<int> queued_;  // submitted, not started
+  std::atomic<unsigned> next_;
+  bool stop_;
+
+  void Run(int index);
+
+  bool Take(int index, std::function<void()> &task);
+};
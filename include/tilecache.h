@@ -0,0 +1,58 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "blockgroup.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+/**
+ * @class TileCache
+ * @brief Remembers what BlockGroup::solve said about a region and its pieces
+ *
+ * The solver asks about the same region with the same pieces over and over,
+ * from the prune and from every check at an end point. The key is the region
+ * moved to (0, 0) plus the pieces as a multiset, each in a fixed rotation
+ * unless oriented, so where a region sits on the board or which cell holds
+ * which piece does not matter. Answers are kept for the capacity_ most
+ * recently used keys.
+ *
+ * Copies of a Grid share its cache, so the solver's worker threads do too.
+ * Every call takes lock_.
+ */
+class TileCache {
+public:
+  static constexpr size_t kCapacity = 4096;
+
+  explicit TileCache(size_t capacity);
+
+  /** @brief region.solve(pieces, tiler), answered from the cache if it can */
+  bool Solve(BlockGroup &region, vector<BlockGroup> &pieces, Tiler tiler);
+
+  long long Hits();
+
+  long long Misses();
+
+  size_t Size();
+
+  void Clear();
+
+private:
+  typedef std::list<pair<string, bool>> Entries;
+
+  size_t capacity_;
+  std::mutex lock_;
+  Entries entries_; // most recently used first
+  std::unordered_map<string, Entries::iterator> index_;
+  long long hits_;
+  long long misses_;
+
+  static string Key(BlockGroup &region, vector<BlockGroup> &pieces);
+};
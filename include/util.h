@@ -9,70 +9,125 @@
 using std::string;
 using std::to_string;
 
+// Symbol kinds each class may carry, as a bit mask over SymbolKind.
+template <typename T> struct SymbolKinds;
+
+#define SYMBOL_KIND_BIT(k) (1u << static_cast<unsigned>(SymbolKind::k))
+
+template <> struct SymbolKinds<Entity> {
+  static constexpr unsigned value = ~0u;
+};
+template <> struct SymbolKinds<Endpoint> {
+  static constexpr unsigned value =
+      SYMBOL_KIND_BIT(kStart) | SYMBOL_KIND_BIT(kEnd);
+};
+template <> struct SymbolKinds<Dot> {
+  static constexpr unsigned value = SYMBOL_KIND_BIT(kDot);
+};
+template <> struct SymbolKinds<Blob> {
+  static constexpr unsigned value = SYMBOL_KIND_BIT(kBlob);
+};
+template <> struct SymbolKinds<Star> {
+  static constexpr unsigned value = SYMBOL_KIND_BIT(kStar);
+};
+template <> struct SymbolKinds<Triangle> {
+  static constexpr unsigned value = SYMBOL_KIND_BIT(kTriangle);
+};
+template <> struct SymbolKinds<Cancel> {
+  static constexpr unsigned value = SYMBOL_KIND_BIT(kCancel);
+};
+template <> struct SymbolKinds<BlockGroup> {
+  static constexpr unsigned value = SYMBOL_KIND_BIT(kBlock);
+};
+
+#undef SYMBOL_KIND_BIT
+
+// Tag test, no RTTI and no refcount traffic.
 template <typename Base, typename T>
-inline bool instanceof(std::shared_ptr<T> ptr) {
-  std::shared_ptr<Base> x = std::dynamic_pointer_cast<Base>(ptr);
-  return x != nullptr;
+inline bool instanceof(const std::shared_ptr<T> &ptr) {
+  if (ptr == nullptr)
+    return false;
+  return (SymbolKinds<Base>::value >> static_cast<unsigned>(ptr->kind_)) & 1;
+}
+
+// Checked downcast through the tag. nullptr if o is not a T.
+template <typename T> inline T *symbol_cast(const std::shared_ptr<Entity> &o) {
+  if (!instanceof<T>(o))
+    return nullptr;
+  return static_cast<T *>(o.get());
+}
+
+inline SymbolKind get_kind(const std::shared_ptr<Entity> &o) {
+  return o->kind_;
 }
 
-inline string get_type(std::shared_ptr<Entity> o) {
-  if (instanceof<BlockGroup>(o))
+// A fresh symbol of kind k in color c, arg being a triangle's count. A block
+// needs its squares (see BlockGroup), so kBlock gives a plain Entity like
+// kNone does.
+inline std::shared_ptr<Entity> make_symbol(SymbolKind k, EntityColor c,
+                                           int arg) {
+  std::shared_ptr<Entity> e;
+  switch (k) {
+  case SymbolKind::kStart:
+  case SymbolKind::kEnd:
+    e = std::make_shared<Endpoint>(k == SymbolKind::kStart);
+    break;
+  case SymbolKind::kDot:
+    e = std::make_shared<Dot>();
+    break;
+  case SymbolKind::kBlob:
+    e = std::make_shared<Blob>();
+    break;
+  case SymbolKind::kStar:
+    e = std::make_shared<Star>();
+    break;
+  case SymbolKind::kTriangle:
+    e = std::make_shared<Triangle>(arg);
+    break;
+  case SymbolKind::kCancel:
+    e = std::make_shared<Cancel>();
+    break;
+  default:
+    e = std::make_shared<Entity>();
+    break;
+  }
+  e->color_ = c;
+  return e;
+}
+
+inline string get_type(const std::shared_ptr<Entity> &o) {
+  switch (o->kind_) {
+  case SymbolKind::kBlock:
     return "+BLOCK";
-  if (instanceof<Endpoint>(o)) {
-    if ((std::dynamic_pointer_cast<Endpoint>(o))->starting_)
-      return "START!";
+  case SymbolKind::kStart:
+    return "START!";
+  case SymbolKind::kEnd:
     return "ENDPT!";
-  }
-  if (instanceof<Dot>(o))
+  case SymbolKind::kDot:
     return "PATHDT";
-  if (instanceof<Star>(o))
+  case SymbolKind::kStar:
     return "_STAR_";
-  if (instanceof<Blob>(o))
+  case SymbolKind::kBlob:
     return "_BLOB_";
-  if (instanceof<Triangle>(o)) {
-    return "TRIX_" + to_string((std::dynamic_pointer_cast<Triangle>(o))->x_);
-  }
-  if (instanceof<Cancel>(o)) {
-    if (!(std::dynamic_pointer_cast<Cancel>(o))->ignored_)
+  case SymbolKind::kTriangle:
+    return "TRIX_" + to_string(static_cast<Triangle *>(o.get())->x_);
+  case SymbolKind::kCancel:
+    if (!static_cast<Cancel *>(o.get())->ignored_)
       return "CANCEL";
-    else
-      return "OBJECT";
+    return "OBJECT";
+  default:
+    return "OBJECT";
   }
-  return "OBJECT";
 }
 
-inline bool isStartingPoint(std::shared_ptr<Entity> o) {
-  if (instanceof<Endpoint>(o)) {
-    if ((std::dynamic_pointer_cast<Endpoint>(o))->starting_)
-      return true;
-    return false;
-  }
-  return false;
+inline bool isStartingPoint(const std::shared_ptr<Entity> &o) {
+  return o->kind_ == SymbolKind::kStart;
 }
 
-inline bool isEndingPoint(std::shared_ptr<Entity> o) {
-  if (instanceof<Endpoint>(o)) {
-    if ((std::dynamic_pointer_cast<Endpoint>(o))->starting_)
-      return false;
-    return true;
-  }
-  return false;
+inline bool isEndingPoint(const std::shared_ptr<Entity> &o) {
+  return o->kind_ == SymbolKind::kEnd;
 }
 
-inline bool isSymbol(std::shared_ptr<Entity> o) {
-  if (instanceof<BlockGroup>(o))
-    return true;
-  if (instanceof<Endpoint>(o))
-    return true;
-  if (instanceof<Dot>(o))
-    return true;
-  if (instanceof<Star>(o))
-    return true;
-  if (instanceof<Blob>(o))
-    return true;
-  if (instanceof<Triangle>(o))
-    return true;
-  if (instanceof<Cancel>(o))
-    return true;
-  return false;
+inline bool isSymbol(const std::shared_ptr<Entity> &o) {
+  return o->kind_ != SymbolKind::kNone;
 }
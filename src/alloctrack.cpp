@@ -0,0 +1,153 @@
+#include "alloctrack.h"
+
+#ifdef WITNESS_ALLOC_TRACKING
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct Counters {
+  std::atomic<int64_t> calls;
+  std::atomic<int64_t> allocs;
+  std::atomic<int64_t> bytes;
+  std::atomic<int64_t> selfallocs;
+  std::atomic<int64_t> selfbytes;
+};
+
+const char *const kSiteNames[kAllocSites] = {
+    "Solve", "IsValid", "  fox", "  wolf", "  drude", "  phoenix",
+    "ValidateRegion"};
+
+Counters sites[kAllocSites];
+std::atomic<int64_t> totalallocs(0);
+std::atomic<int64_t> totalbytes(0);
+
+// This thread's allocations so far, and its innermost open scope. Plain
+// values with no constructor, so operator new may touch them at any time.
+thread_local int64_t threadallocs = 0;
+thread_local int64_t threadbytes = 0;
+thread_local int current = -1;
+
+void *Allocate(size_t n, size_t align) {
+  totalallocs.fetch_add(1, std::memory_order_relaxed);
+  totalbytes.fetch_add(n, std::memory_order_relaxed);
+  threadallocs++;
+  threadbytes += n;
+  if (current >= 0) {
+    sites[current].selfallocs.fetch_add(1, std::memory_order_relaxed);
+    sites[current].selfbytes.fetch_add(n, std::memory_order_relaxed);
+  }
+  if (n == 0)
+    n = 1;
+  if (align <= alignof(std::max_align_t))
+    return std::malloc(n);
+  return std::aligned_alloc(align, (n + align - 1) / align * align);
+}
+
+} // namespace
+
+AllocScope::AllocScope(AllocSite site) : site_(site), outer_(current) {
+  current = site;
+  allocs_ = threadallocs;
+  bytes_ = threadbytes;
+  sites[site].calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+AllocScope::~AllocScope() {
+  Close();
+  current = outer_;
+}
+
+void AllocScope::Close() {
+  sites[site_].allocs.fetch_add(threadallocs - allocs_,
+                                std::memory_order_relaxed);
+  sites[site_].bytes.fetch_add(threadbytes - bytes_,
+                               std::memory_order_relaxed);
+}
+
+void AllocScope::Switch(AllocSite site) {
+  Close();
+  site_ = site;
+  current = site;
+  allocs_ = threadallocs;
+  bytes_ = threadbytes;
+  sites[site].calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+AllocStats GetAllocStats(AllocSite site) {
+  Counters &c = sites[site];
+  return {c.calls.load(), c.allocs.load(), c.bytes.load(),
+          c.selfallocs.load(), c.selfbytes.load()};
+}
+
+void ResetAllocStats() {
+  for (auto &c : sites) {
+    c.calls = 0;
+    c.allocs = 0;
+    c.bytes = 0;
+    c.selfallocs = 0;
+    c.selfbytes = 0;
+  }
+}
+
+AllocStats AllocTotals() {
+  return {0, totalallocs.load(), totalbytes.load(), 0, 0};
+}
+
+void PrintAllocStats(std::FILE *out) {
+  std::fprintf(out, "%-16s %12s %12s %12s %12s %12s\n", "allocations",
+               "calls", "allocs/call", "bytes/call", "self allocs", "self bytes");
+  for (int s = 0; s < kAllocSites; s++) {
+    AllocStats a = GetAllocStats((AllocSite)s);
+    if (a.calls == 0)
+      continue;
+    double n = a.calls;
+    std::fprintf(out, "%-16s %12lld %12.1f %12.0f %12.1f %12.0f\n",
+                 kSiteNames[s], (long long)a.calls, a.allocs / n, a.bytes / n,
+                 a.selfallocs / n, a.selfbytes / n);
+  }
+}
+
+void *operator new(size_t n) {
+  if (void *p = Allocate(n, 0))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t n) { return operator new(n); }
+
+void *operator new(size_t n, std::align_val_t a) {
+  if (void *p = Allocate(n, (size_t)a))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t n, std::align_val_t a) {
+  return operator new(n, a);
+}
+
+void *operator new(size_t n, const std::nothrow_t &) noexcept {
+  return Allocate(n, 0);
+}
+
+void *operator new[](size_t n, const std::nothrow_t &) noexcept {
+  return Allocate(n, 0);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "blockgroup.h"
+#include "placements.h"
 
 #include <algorithm>
 #include <iostream>
@@ -37,6 +38,7 @@ BlockGroup::BlockGroup(bool orientation, bool subtractive,
                  topright.second - bottomleft.second + 1};
 
   color_ = color;
+  kind_ = SymbolKind::kBlock;
 }
 
 BlockGroup::BlockGroup(bool orientation, bool subtractive,
@@ -60,6 +62,7 @@ BlockGroup::BlockGroup(bool orientation, bool subtractive,
                  topright.second - bottomleft.second + 1};
 
   color_ = EntityColor::kYELLOW;
+  kind_ = SymbolKind::kBlock;
 }
 
 void BlockGroup::updateBounds() {
@@ -296,7 +299,7 @@ bool BlockGroup::dfsUtil(BlockGroup region, vector<BlockGroup> &v, int index) {
   return res;
 }
 
-bool BlockGroup::solve(vector<BlockGroup> v) {
+bool BlockGroup::solve(vector<BlockGroup> v, Tiler tiler) {
   int diff = n;
   for (auto i : v) {
     if (i.sub)
@@ -306,5 +309,20 @@ bool BlockGroup::solve(vector<BlockGroup> v) {
   }
   if (diff != 0)
     return false;
+
+  // Precomputed placement masks for any region that fits in 256 cells, which
+  // is every region of every panel the game makes. dfsUtil stays for the rest.
+  if (n <= Placements<1>::kCells) {
+    Placements<1> table;
+    if (!table.Build(*this, v))
+      return false;
+    return tiler == Tiler::kExactCover ? table.Cover() : table.Tile();
+  }
+  if (n <= Placements<4>::kCells) {
+    Placements<4> table;
+    if (!table.Build(*this, v))
+      return false;
+    return tiler == Tiler::kExactCover ? table.Cover() : table.Tile();
+  }
   return dfsUtil(clone(), v, 0);
 }
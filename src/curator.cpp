@@ -0,0 +1,84 @@
+#include "curator.h"
+
+#include <chrono>
+#include <mutex>
+
+#include "solver.h"
+
+Curator::Curator(int threads, unsigned seed)
+    : generated_(0), accepted_(0), unsolvable_(0), ambiguous_(0),
+      outside_(0), seconds_(0), pool_(threads) {
+  std::random_device rd;
+  for (int i = 0; i < pool_.Size(); i++) {
+    generators_.push_back(std::make_unique<RandGrid>());
+    unsigned s = seed == 0 ? rd() : seed + i;
+    generators_.back()->gen = mt19937(s);
+    generators_.back()->g = mt19937(s ^ 0x5bd1e995);
+  }
+}
+
+Rating Curator::Rate(Grid &g, long long limit) {
+  Solver s(g);
+  s.seed_ = 1;
+  Rating r;
+  r.solutions = s.CountSolutions(limit);
+  r.nodes = 0;
+  if (r.solutions > 0) {
+    s.Solve();
+    r.nodes = s.callstopath_;
+  }
+  return r;
+}
+
+vector<Curator::Panel> Curator::Make(PuzzleFamily family, int count,
+                                     const Filter &filter,
+                                     long long attempts) {
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<long long> tries(0), generated(0), unsolvable(0), ambiguous(0),
+      outside(0);
+  std::atomic<int> kept(0);
+  std::mutex lock;
+  vector<Panel> res;
+
+  // One solution more than allowed is enough to reject a panel.
+  long long limit = filter.maxsolutions > 0 ? filter.maxsolutions + 1 : 1;
+
+  for (int w = 0; w < pool_.Size(); w++) {
+    pool_.Submit([&] {
+      RandGrid &rg = *generators_[ThreadPool::WorkerIndex()];
+      while (kept < count && tries++ < attempts) {
+        Grid g = rg.randFamily(family);
+        generated++;
+        Rating r = Rate(g, limit);
+        if (r.solutions == 0) {
+          unsolvable++;
+          continue;
+        }
+        if (filter.maxsolutions > 0 && r.solutions > filter.maxsolutions) {
+          ambiguous++;
+          continue;
+        }
+        if (r.nodes < filter.minnodes || r.nodes > filter.maxnodes) {
+          outside++;
+          continue;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        if ((int)res.size() < count) {
+          res.push_back({g, r});
+          kept++;
+        }
+      }
+    });
+  }
+  pool_.Wait();
+
+  generated_ = generated;
+  accepted_ = res.size();
+  unsolvable_ = unsolvable;
+  ambiguous_ = ambiguous;
+  outside_ = outside;
+  seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           start)
+                 .count();
+  return res;
+}
@@ -1,25 +1,27 @@
 #include "grid.h"
+#include "alloctrack.h"
 #include "object.h"
+#include "regions.h"
 #include "util.h"
 #include <algorithm>
 #include <iostream>
 #include <map>
 #include <memory>
-#include <queue>
 
 using std::cout;
 using std::endl;
 using std::make_pair;
 using std::map;
 using std::pair;
-using std::queue;
 
 // Once a grid is created it cannot be changed unless changes are consistent
 // across all aspects.
 Grid::Grid(vector<vector<std::shared_ptr<Entity>>> &v) {
+  tiler_ = Tiler::kExactCover;
+  tilecache_ = std::make_shared<TileCache>(TileCache::kCapacity);
   m_ = v.size();
   n_ = 0;
-  for (auto i : v)
+  for (auto &i : v)
     n_ = std::max((int)(i.size()), n_);
   if (m_ % 2 == 0)
     m_++;
@@ -32,37 +34,78 @@ Grid::Grid(vector<vector<std::shared_ptr<Entity>>> &v) {
   starts_ = set<pair<int, int>>();
   ends_ = set<pair<int, int>>();
 
+  cells_ = vector<Cell>(m_ * n_, Cell{SymbolKind::kNone, 0, 0, 0});
+  pathable_ = Bitboard(m_ * n_);
+  occupied_ = Bitboard(m_ * n_);
+  for (auto &b : symbols_)
+    b = Bitboard(m_ * n_);
+
   for (int i = 0; i < m_; i++) {
     for (int j = 0; j < n_; j++) {
-      if ((size_t)j < v[i].size())
-        board_[i][j] = v[i][j];
-      if (isStartingPoint(board_[i][j])) {
+      std::shared_ptr<Entity> e;
+      if ((size_t)i < v.size() && (size_t)j < v[i].size())
+        e = v[i][j];
+      if (e == nullptr)
+        e = std::make_shared<Entity>();
+      pathable_.assign(Index({i, j}), e->is_path_);
+      occupied_.assign(Index({i, j}), e->is_path_occupied_);
+      Place({i, j}, e);
+      if (cells_[Index({i, j})].kind == SymbolKind::kStart)
         begin_ = {i, j};
-        starts_.insert({i, j});
-      }
-      if (isEndingPoint(board_[i][j]))
-        ends_.insert({i, j});
-      if (instanceof<Dot>(board_[i][j]))
-        dots_.insert({i, j});
-      if (instanceof<Blob>(board_[i][j]))
-        blobs_.insert({i, j});
-      if (instanceof<Star>(board_[i][j]))
-        stars_.insert({i, j});
-      if (instanceof<Triangle>(board_[i][j]))
-        triangles_.insert({i, j});
-      if (instanceof<BlockGroup>(board_[i][j]))
-        blocks_.insert({i, j});
-      if (instanceof<Cancel>(board_[i][j]))
-        cancels_.insert({i, j});
     }
   }
 }
 
+set<pair<int, int>> *Grid::SymbolList(SymbolKind k) {
+  switch (k) {
+  case SymbolKind::kStart:
+    return &starts_;
+  case SymbolKind::kEnd:
+    return &ends_;
+  case SymbolKind::kDot:
+    return &dots_;
+  case SymbolKind::kBlob:
+    return &blobs_;
+  case SymbolKind::kStar:
+    return &stars_;
+  case SymbolKind::kTriangle:
+    return &triangles_;
+  case SymbolKind::kBlock:
+    return &blocks_;
+  case SymbolKind::kCancel:
+    return &cancels_;
+  default:
+    return nullptr;
+  }
+}
+
+void Grid::Place(pair<int, int> p, std::shared_ptr<Entity> e) {
+  int idx = Index(p);
+  Cell &c = cells_[idx];
+
+  set<pair<int, int>> *old = SymbolList(c.kind);
+  if (old != nullptr)
+    old->erase(p);
+  symbols_[static_cast<int>(c.kind)].reset(idx);
+
+  board_[p.first][p.second] = e;
+  c.kind = get_kind(e);
+  c.color = PaletteIndex(e->color_);
+  c.arg = 0;
+  if (c.kind == SymbolKind::kTriangle)
+    c.arg = symbol_cast<Triangle>(e)->x_;
+
+  symbols_[static_cast<int>(c.kind)].set(idx);
+  set<pair<int, int>> *now = SymbolList(c.kind);
+  if (now != nullptr)
+    now->insert(p);
+}
+
 void Grid::DefaultGrid() {
   for (int i = 0; i < m_; i++) {
     for (int j = 0; j < n_; j++) {
       if (i % 2 == 0 || j % 2 == 0)
-        (board_[i][j])->is_path_ = true;
+        SetPath({i, j}, true);
     }
   }
 }
@@ -72,12 +115,12 @@ void Grid::DrawStraight(pair<int, int> a, pair<int, int> b) {
     if (a.second > b.second)
       swap(a, b);
     for (int i = a.second; i <= b.second; i++)
-      board_[a.first][i]->is_path_occupied_ = true;
+      SetOccupied({a.first, i}, true);
   } else if (a.second == b.second) {
     if (a.first > b.first)
       swap(a, b);
     for (int i = a.first; i <= b.first; i++)
-      board_[i][a.second]->is_path_occupied_ = true;
+      SetOccupied({i, a.second}, true);
   }
 }
 
@@ -88,7 +131,7 @@ void Grid::DrawPath(vector<pair<int, int>> v) {
     DrawStraight(v[i - 1], v[i]);
 }
 
-Grid::Grid() {}
+Grid::Grid() : m_(0), n_(0), tiler_(Tiler::kExactCover) {}
 
 Grid::~Grid() {
   for (int i = 0; (size_t)i < board_.size(); i++) {
@@ -98,32 +141,30 @@ Grid::~Grid() {
   }
 }
 
-string Grid::ToString() {
-  string s = "";
-  for (auto i : board_) {
-    for (auto j : i) {
-      char open = j->is_path_occupied_ ? '[' : (j->is_path_ ? '+' : '_');
-      char close = j->is_path_occupied_ ? ']' : (j->is_path_ ? '+' : '_');
-      s = s + open + get_type(j) + close + " ";
+string Grid::ToString() const {
+  // Appended in place: every cell is "[TYPE] ", nine characters or a few
+  // more for a triangle, and a newline ends every row but the last.
+  string s;
+  s.reserve(m_ * (n_ * 9 + 1));
+  for (int i = 0; i < m_; i++) {
+    if (i > 0)
+      s += '\n';
+    for (int j = 0; j < n_; j++) {
+      bool occupied = IsOccupied({i, j});
+      bool path = IsPath({i, j});
+      s += occupied ? '[' : (path ? '+' : '_');
+      s += get_type(board_[i][j]);
+      s += occupied ? ']' : (path ? '+' : '_');
+      s += ' ';
     }
-    s = s + "\n";
   }
-  return s.substr(0, s.length() - 1);
+  return s;
 }
 
 void Grid::Display() { cout << ToString() << endl; }
 
 // The verification algorithm
 
-bool Grid::Inside(pair<int, int> p) {
-  if (p.first < 0 || p.second < 0)
-    return false;
-  if ((size_t)(p.first) >= board_.size() ||
-      (size_t)(p.second) >= board_[p.first].size())
-    return false;
-  return true;
-}
-
 bool Grid::IsValid(int sx, int sy) {
 
   // cout << "VERIFYING GRID" << endl;
@@ -142,44 +183,38 @@ bool Grid::IsValid(int sx, int sy) {
   // symbols are put into a set. However, this is arguably the most important
   // section because it establishes the trajectory of the path.
 
+  AllocScope call(kAllocIsValid);
+  AllocScope phase(kAllocFox);
+
   const int dx[4] = {01, 00, -1, 00};
   const int dy[4] = {00, 01, 00, -1};
-  if (!isStartingPoint(board_[sx][sy]))
+  if (KindAt({sx, sy}) != SymbolKind::kStart)
     return false;
-  std::shared_ptr<Entity> o = board_[sx][sy];
-  if (!o->is_path_occupied_)
+  if (!IsOccupied({sx, sy}))
     return false;
 
   // cout << "BASIC CHECK COMPLETED";
 
-  set<pair<int, int>> vis;
-  queue<pair<int, int>> q;
-  q.push({sx, sy});
+  // The line is the region of the start among the occupied path cells.
+  Bitboard offline = ~(pathable_ & occupied_);
+  offline.reset(Index({sx, sy}));
+  Regions line;
+  line.LabelCells(m_, n_, offline);
 
   bool reachedend = false;
 
-  while (q.size() > 0) {
-    pair<int, int> p = q.front();
-    q.pop();
-    vis.insert(p);
+  int start = line.At({sx, sy});
+  for (const int *k = line.Begin(start); k != line.End(start); k++) {
+    pair<int, int> p = {*k / n_, *k % n_};
     for (int i = 0; i < 4; i++) {
       pair<int, int> next = {p.first + dx[i], p.second + dy[i]};
       if (!Inside(next))
         continue;
-      std::shared_ptr<Entity> n = board_[next.first][next.second];
-      if (isEndingPoint(n))
+      if (KindAt(next) == SymbolKind::kEnd)
         reachedend = true;
-      if (!n->is_path_ || !n->is_path_occupied_)
-        continue;
-      if (vis.find(next) != vis.end())
-        continue;
-      vis.insert(next);
-      q.push(next);
     }
   }
 
-  // for (auto i : vis) cout << i.first << " " << i.second << endl;
-
   if (!reachedend)
     return false;
 
@@ -188,24 +223,20 @@ bool Grid::IsValid(int sx, int sy) {
   set<pair<int, int>> violations;
 
   for (auto i : dots_) {
-    std::shared_ptr<Entity> o = board_[i.first][i.second];
-    if (!o->is_path_occupied_)
+    if (!IsOccupied(i))
       violations.insert(i);
   }
 
   for (auto i : triangles_) {
-    std::shared_ptr<Entity> o = board_[i.first][i.second];
-    if (!instanceof<Triangle>(o))
+    if (KindAt(i) != SymbolKind::kTriangle)
       continue;
-    int target = (std::dynamic_pointer_cast<Triangle>(o))->x_;
+    int target = CellAt(i).arg;
     int count = 0;
     for (int ii = 0; ii < 4; ii++) {
-      int xp = i.first + dx[ii];
-      int yp = i.second + dy[ii];
-      if (!Inside({xp, yp}))
+      pair<int, int> side = {i.first + dx[ii], i.second + dy[ii]};
+      if (!Inside(side))
         continue;
-      std::shared_ptr<Entity> o2 = board_[xp][yp];
-      if (o2->is_path_ && o2->is_path_occupied_)
+      if (IsPath(side) && IsOccupied(side))
         count++;
     }
 
@@ -226,77 +257,37 @@ bool Grid::IsValid(int sx, int sy) {
   // blue dots are marked as violation. Cancellation symbols will also ``seek''
   // the blue dots.
 
-  map<EntityColor, vector<std::shared_ptr<Entity>>> ding; // List of colors
+  phase.Switch(kAllocWolf);
+
+  map<EntityColor, int> ding; // Number of symbols per color
   map<EntityColor, int> selectedcolors;
   set<pair<int, int>> collected;
 
-  vis.clear();
+  // Blobs, stars and polyominos all share one labelling of the symbol cells.
+  // Symbols off that lattice (an even coordinate) belong to no region.
+  Regions regions;
+  regions.LabelLattice(m_, n_, occupied_);
+  vector<bool> seen(regions.count_, false);
 
   for (auto ii : blobs_) {
-    if (vis.find(ii) != vis.end())
+    int r = regions.At(ii);
+    if (r < 0 || seen[r])
       continue;
+    seen[r] = true;
     ding.clear();
     selectedcolors.clear();
     collected.clear();
-    queue<pair<int, int>> q;
-    q.push(ii);
-    while (q.size() > 0) {
-      pair<int, int> now = q.front();
-      q.pop();
-      vis.insert(now);
-
-      // cout << now.first << " / " << now.second << endl;
-
-      std::shared_ptr<Entity> cur = board_[now.first][now.second];
-
-      if (instanceof<Blob>(cur)) {
-        if (ding.find(cur->color_) == ding.end())
-          ding.insert({cur->color_, vector<std::shared_ptr<Entity>>()});
-        (*(ding.find(cur->color_))).second.push_back(cur);
-      }
-
-      if (instanceof<Blob>(cur)) {
-        collected.insert(now);
-        if (selectedcolors.find(cur->color_) == selectedcolors.end())
-          selectedcolors.insert({cur->color_, 0});
-        (*(selectedcolors.find(cur->color_))).second++;
-      }
-
-      for (int i = 0; i < 4; i++) {
-        pair<int, int> mid = {now.first + dx[i], now.second + dy[i]};
-        pair<int, int> next = {now.first + dx[i] * 2, now.second + dy[i] * 2};
-        if (!Inside(mid) || !Inside(next))
-          continue;
-        std::shared_ptr<Entity> between = board_[mid.first][mid.second];
-        // std::shared_ptr<Entity> hit = board[next.first][next.second];
-        if (between->is_path_occupied_)
-          continue;
-        if (vis.find(next) != vis.end())
-          continue;
-        vis.insert(next);
-        q.push(next);
+    for (const int *k = regions.Begin(r); k != regions.End(r); k++) {
+      const Cell &cur = cells_[*k];
+
+      if (cur.kind == SymbolKind::kBlob) {
+        EntityColor c = kPalette[cur.color];
+        ding[c]++;
+        collected.insert({*k / n_, *k % n_});
+        selectedcolors[c]++;
       }
     }
 
-    /*
-
-            cout << "BLOB FOR BLOB " << ii.first << " " << ii.second << endl;
-
-            for (auto i : vis) cout << i.first << " " << i.second << endl;
-
-            cout << "COLORS!!!" << endl;
-            for (auto i : ding) {
-                cout << i.first << endl;
-                for (auto x : i.second) cout << get_type(x) << endl;
-            }
-
-            cout << "BLOB COLORS!!!" << endl;
-            for (auto i : selectedcolors) {
-                cout << i.first << " = " << i.second << endl;
-            }
-
-            */
-
     // Now we determine where the violations were.
     // Among all colors that have a blob, the highest one ``wins'' and the
     // others ``lose''. Ties are broken arbitrarily for now.
@@ -306,7 +297,7 @@ bool Grid::IsValid(int sx, int sy) {
     for (auto i : selectedcolors) {
       if (ding.find(i.first) == ding.end())
         continue;
-      int truefreq = ding.at(i.first).size();
+      int truefreq = ding.at(i.first);
       if (truefreq > maxfreq) {
         maxfreq = truefreq;
         maxcolor = i.first;
@@ -321,8 +312,8 @@ bool Grid::IsValid(int sx, int sy) {
 
     // cout << "AND THE WINNING COLOR IS " << maxcolor << endl;
     for (auto i : collected) {
-      if (board_[i.first][i.second]->color_ != maxcolor &&
-          board_[i.first][i.second]->color_ != EntityColor::NIL)
+      EntityColor c = kPalette[CellAt(i).color];
+      if (c != maxcolor && c != EntityColor::NIL)
         violations.insert(i);
       else if (hasmorecolors)
         violations.insert(i);
@@ -331,78 +322,29 @@ bool Grid::IsValid(int sx, int sy) {
 
   // The other task of THE WOLF is to handle stars. Thankfully, these are
   // easier.
-  vis.clear();
+  seen.assign(regions.count_, false);
 
   for (auto ii : stars_) {
-    if (vis.find(ii) != vis.end())
+    int r = regions.At(ii);
+    if (r < 0 || seen[r])
       continue;
+    seen[r] = true;
     ding.clear();
-    selectedcolors.clear();
     collected.clear();
-    queue<pair<int, int>> q;
-    q.push(ii);
-    while (q.size() > 0) {
-      pair<int, int> now = q.front();
-      q.pop();
-      vis.insert(now);
-
-      // cout << now.first << " / " << now.second << endl;
-
-      std::shared_ptr<Entity> cur = board_[now.first][now.second];
-
-      if (ding.find(cur->color_) == ding.end())
-        ding.insert({cur->color_, vector<std::shared_ptr<Entity>>()});
-      (*(ding.find(cur->color_))).second.push_back(cur);
-
-      if (instanceof<Star>(cur)) {
-        collected.insert(now);
-        if (selectedcolors.find(cur->color_) == selectedcolors.end())
-          selectedcolors.insert({cur->color_, 0});
-        (*(selectedcolors.find(cur->color_))).second++;
-      }
-
-      for (int i = 0; i < 4; i++) {
-        pair<int, int> mid = {now.first + dx[i], now.second + dy[i]};
-        pair<int, int> next = {now.first + dx[i] * 2, now.second + dy[i] * 2};
-        if (!Inside(mid) || !Inside(next))
-          continue;
-        std::shared_ptr<Entity> between = board_[mid.first][mid.second];
-        // std::shared_ptr<Entity> hit = board[next.first][next.second];
-        if (between->is_path_occupied_)
-          continue;
-        if (vis.find(next) != vis.end())
-          continue;
-        vis.insert(next);
-        q.push(next);
-      }
-    }
-
-    /*
-    cout << "STAR FOR STAR " << ii.first << " " << ii.second << endl;
-
-    for (auto i : vis)
-      cout << i.first << " " << i.second << endl;
-
-    cout << "COLORS!!!" << endl;
-    for (auto i : ding) {
-      cout << i.first << endl;
-      for (auto x : i.second)
-        cout << get_type(x) << endl;
+    for (const int *k = regions.Begin(r); k != regions.End(r); k++) {
+      const Cell &cur = cells_[*k];
+      ding[kPalette[cur.color]]++;
+      if (cur.kind == SymbolKind::kStar)
+        collected.insert({*k / n_, *k % n_});
     }
 
-    cout << "STAR COLORS!!!" << endl;
-    for (auto i : selectedcolors) {
-      cout << i.first << " = " << i.second << endl;
-    }
-    */
-
     for (auto i : collected) {
-      EntityColor x = board_[i.first][i.second]->color_;
+      EntityColor x = kPalette[CellAt(i).color];
       if (ding.find(x) == ding.end()) {
         violations.insert(i);
         continue;
       }
-      if (ding.at(x).size() != 2)
+      if (ding.at(x) != 2)
         violations.insert(i);
     }
   }
@@ -414,68 +356,33 @@ bool Grid::IsValid(int sx, int sy) {
   // brute force. After all, this problem is NP-complete. What happens here is
   // simply a partition of the board and a check.
 
-  vis.clear();
+  phase.Switch(kAllocDrude);
 
-  set<pair<int, int>> region;
+  seen.assign(regions.count_, false);
 
   for (auto ii : blocks_) {
-    if (vis.find(ii) != vis.end())
+    int r = regions.At(ii);
+    if (r < 0 || seen[r])
       continue;
-    region.clear();
+    seen[r] = true;
     collected.clear();
-    queue<pair<int, int>> q;
-    q.push(ii);
-    while (q.size() > 0) {
-      pair<int, int> now = q.front();
-      q.pop();
-      vis.insert(now);
-      region.insert(now);
-
-      // cout << now.first << " / " << now.second << endl;
-
-      std::shared_ptr<Entity> cur = board_[now.first][now.second];
-
-      if (instanceof<BlockGroup>(cur))
+    vector<pair<int, int>> regionvec;
+    for (const int *k = regions.Begin(r); k != regions.End(r); k++) {
+      pair<int, int> now = {*k / n_, *k % n_};
+      if (cells_[*k].kind == SymbolKind::kBlock)
         collected.insert(now);
-
-      for (int i = 0; i < 4; i++) {
-        pair<int, int> mid = {now.first + dx[i], now.second + dy[i]};
-        pair<int, int> next = {now.first + dx[i] * 2, now.second + dy[i] * 2};
-        if (!Inside(mid) || !Inside(next))
-          continue;
-        std::shared_ptr<Entity> between = board_[mid.first][mid.second];
-        // std::shared_ptr<Entity> hit = board[next.first][next.second];
-        if (between->is_path_occupied_)
-          continue;
-        if (vis.find(next) != vis.end())
-          continue;
-        vis.insert(next);
-        q.push(next);
-      }
+      regionvec.push_back(make_pair((now.second) >> 1, -1 * (now.first) >> 1));
     }
 
-    /*
-            cout << "TETRIS LOCATIONS" << endl;
-            for (auto i : collected) cout << i.first << " " << i.second << endl;
-
-            cout << "REGION" << endl;
-            for (auto i : region) cout << i.first << " " << i.second << endl;
-            */
-
-    vector<pair<int, int>> regionvec;
-    for (auto i : region)
-      regionvec.push_back(make_pair((i.second) >> 1, -1 * (i.first) >> 1));
-
     BlockGroup testregion = BlockGroup(1, 0, regionvec);
     vector<BlockGroup> pieces;
     for (auto i : collected) {
-      std::shared_ptr<Entity> o = board_[i.first][i.second];
-      if (!instanceof<BlockGroup>(o))
+      BlockGroup *bg = symbol_cast<BlockGroup>(board_[i.first][i.second]);
+      if (bg == nullptr)
         continue;
-      std::shared_ptr<BlockGroup> bg = std::dynamic_pointer_cast<BlockGroup>(o);
       pieces.push_back(*bg);
     }
-    if (testregion.solve(pieces))
+    if (Tile(testregion, pieces))
       ;
     else {
       for (auto i : collected)
@@ -496,49 +403,38 @@ bool Grid::IsValid(int sx, int sy) {
     return violations.size() == 0;
   }
 
+  phase.Switch(kAllocPhoenix);
+
   // cout << "NET VIOLATIONS - MOVING TO CANCELS..." << endl;
   // for (auto i : violations) cout << i.first << " " << i.second << endl;
 
   if (violations.size() == 0)
     return false; // There are cancels!!!
 
-  vis.clear();
+  // A cancel searches its region of the board off the line, one step at a
+  // time. Regions an earlier cancel already searched are not searched again.
+  Regions open;
+  open.LabelCells(m_, n_, occupied_);
+  seen.assign(open.count_, false);
+
   for (auto ii : cancels_) {
     if (ignored_.find(ii) != ignored_.end())
       continue;
     collected.clear();
-    queue<pair<int, int>> q;
-    q.push(ii);
-    while (q.size() > 0) {
-      pair<int, int> now = q.front();
-      q.pop();
-      vis.insert(now);
-      region.insert(now);
-
-      // cout << now.first << " / " << now.second << endl;
-
-      std::shared_ptr<Entity> cur = board_[now.first][now.second];
-      if (isSymbol(cur) && !instanceof<Cancel>(cur)) {
-        if (violations.find(now) != violations.end())
-          collected.insert(now);
-      }
-      for (int i = 0; i < 4; i++) {
-        pair<int, int> next = {now.first + dx[i], now.second + dy[i]};
-        if (!Inside(next))
-          continue;
-        std::shared_ptr<Entity> hit = board_[next.first][next.second];
-        if (hit->is_path_occupied_)
-          continue;
-        if (vis.find(next) != vis.end())
-          continue;
-        vis.insert(next);
-        q.push(next);
+    int r = open.At(ii);
+    if (r >= 0 && !seen[r]) {
+      seen[r] = true;
+      for (const int *k = open.Begin(r); k != open.End(r); k++) {
+        pair<int, int> now = {*k / n_, *k % n_};
+        SymbolKind kind = cells_[*k].kind;
+        if (kind != SymbolKind::kNone && kind != SymbolKind::kCancel) {
+          if (violations.find(now) != violations.end())
+            collected.insert(now);
+        }
       }
     }
 
     ignored_.insert(ii);
-    (std::dynamic_pointer_cast<Cancel>(board_[ii.first][ii.second]))->ignored_ =
-        true;
 
     // cout << "SYMBOL LOCATIONS FOR CANCEL " << ii.first << " " << ii.second <<
     // endl; cout << "CANCEL STATUS " << cancels.size() << " " << ignored.size()
@@ -547,41 +443,19 @@ bool Grid::IsValid(int sx, int sy) {
     for (auto i : collected) {
       // cout << i.first << " " << i.second << endl;
       std::shared_ptr<Entity> o = board_[i.first][i.second];
-      board_[i.first][i.second] = o->Clear();
-      if (instanceof<Dot>(o))
-        dots_.erase(dots_.find(i));
-      else if (instanceof<Star>(o))
-        stars_.erase(stars_.find(i));
-      else if (instanceof<Blob>(o))
-        blobs_.erase(blobs_.find(i));
-      else if (instanceof<Triangle>(o))
-        triangles_.erase(triangles_.find(i));
-      else if (instanceof<BlockGroup>(o))
-        blocks_.erase(blocks_.find(i));
+      Place(i, o->Clear());
       // disp();
       // cout << "VERIFYING MODIFIED..." << endl;
       if (IsValid(sx, sy)) {
         retval = true;
       }
       // cout << "FINISHED VERIFYING MODIFIED\n";
-      board_[i.first][i.second] = o;
-      if (instanceof<Dot>(o))
-        dots_.insert(i);
-      else if (instanceof<Star>(o))
-        stars_.insert(i);
-      else if (instanceof<Blob>(o))
-        blobs_.insert(i);
-      else if (instanceof<Triangle>(o))
-        triangles_.insert(i);
-      else if (instanceof<BlockGroup>(o))
-        blocks_.insert(i);
+      Place(i, o);
       if (retval)
         break;
     }
 
     ignored_.erase(ignored_.find(ii));
-    (std::dynamic_pointer_cast<Cancel>(board_[ii.first][ii.second]))->ignored_ =
-        false;
     // cout << "FINISHED CANCELLING...\n";
     // disp();
     if (retval)
@@ -603,6 +477,7 @@ bool Grid::Check() { return IsValid(begin_.first, begin_.second); }
 // UPDATE - This test now tests blocks as well.
 
 bool Grid::ValidateRegion(int sx, int sy, vector<pair<int, int>> ban) {
+  AllocScope call(kAllocValidateRegion);
   set<pair<int, int>> banned;
   for (auto i : ban)
     banned.insert(i);
@@ -616,67 +491,59 @@ bool Grid::ValidateRegion(int sx, int sy, vector<pair<int, int>> ban) {
   set<pair<int, int>> cancels;
   set<pair<int, int>> blocks;
 
-  set<pair<int, int>> vis;
-  queue<pair<int, int>> q;
-  q.push({sx, sy});
-
-  while (q.size() > 0) {
-    pair<int, int> now = q.front();
-    q.pop();
-
-    vis.insert(now);
-    std::shared_ptr<Entity> o = board_[now.first][now.second];
-
-    if (instanceof<Blob>(o))
+  Bitboard blocked = occupied_;
+  for (auto i : banned)
+    if (Inside(i))
+      blocked.set(Index(i));
+  blocked.reset(Index({sx, sy}));
+  Regions open;
+  open.LabelCells(m_, n_, blocked);
+  int r = open.At({sx, sy});
+
+  for (const int *k = open.Begin(r); k != open.End(r); k++) {
+    pair<int, int> now = {*k / n_, *k % n_};
+    switch (cells_[*k].kind) {
+    case SymbolKind::kBlob:
       blobs.insert(now);
-    if (instanceof<Triangle>(o))
+      break;
+    case SymbolKind::kTriangle:
       triangles.insert(now);
-    if (instanceof<Dot>(o))
+      break;
+    case SymbolKind::kDot:
       dots.insert(now);
-    if (instanceof<Cancel>(o))
+      break;
+    case SymbolKind::kCancel:
       return true;
-    if (instanceof<BlockGroup>(o))
+    case SymbolKind::kBlock:
       blocks.insert(now);
-
-    for (int i = 0; i < 4; i++) {
-      pair<int, int> next = {now.first + dx[i], now.second + dy[i]};
-      if (!Inside(next))
-        continue;
-      std::shared_ptr<Entity> hit = board_[next.first][next.second];
-      if (hit->is_path_occupied_)
-        continue;
-      if (banned.find(next) != banned.end())
-        continue;
-      if (vis.find(next) != vis.end())
-        continue;
-      vis.insert(next);
-      q.push(next);
+      break;
+    default:
+      break;
     }
   }
 
   set<EntityColor> colors;
   for (auto i : blobs)
-    colors.insert(board_[i.first][i.second]->color_);
+    colors.insert(kPalette[CellAt(i).color]);
   if (colors.size() > 1)
     return false;
 
   for (auto i : dots)
-    if (!board_[i.first][i.second]->is_path_occupied_ &&
+    if (!IsOccupied(i) &&
         banned.find(i) != banned.end())
       return false;
 
   for (auto i : triangles) {
-    std::shared_ptr<Entity> o = board_[i.first][i.second];
-    if (!instanceof<Triangle>(o))
+    if (KindAt(i) != SymbolKind::kTriangle)
       continue;
-    int target = (std::dynamic_pointer_cast<Triangle>(o))->x_;
+    int target = CellAt(i).arg;
 
     int cnt = 0;
     for (int d = 0; d < 4; d++) {
       pair<int, int> sus = {i.first + dx[d], i.second + dy[d]};
       if (!Inside(sus))
         continue;
-      if (board_[sus.first][sus.second]->is_path_occupied_ ||
+      if (IsOccupied(sus) ||
           banned.find(sus) != banned.end())
         cnt++;
     }
@@ -690,7 +557,8 @@ bool Grid::ValidateRegion(int sx, int sy, vector<pair<int, int>> ban) {
     return true;
 
   vector<pair<int, int>> effectiveRegion;
-  for (auto i : vis) {
+  for (const int *k = open.Begin(r); k != open.End(r); k++) {
+    pair<int, int> i = {*k / n_, *k % n_};
     if (i.first % 2 == 0 || i.second % 2 == 0)
       continue;
     effectiveRegion.push_back(make_pair(i.second / 2, -1 * i.first / 2));
@@ -698,18 +566,25 @@ bool Grid::ValidateRegion(int sx, int sy, vector<pair<int, int>> ban) {
 
   vector<BlockGroup> boop;
   for (auto i : blocks) {
-    std::shared_ptr<Entity> o = board_[i.first][i.second];
-    if (!instanceof<BlockGroup>(o))
+    BlockGroup *bg = symbol_cast<BlockGroup>(board_[i.first][i.second]);
+    if (bg == nullptr)
       continue;
-    boop.push_back(*(std::dynamic_pointer_cast<BlockGroup>(o)));
+    boop.push_back(*bg);
   }
 
   BlockGroup bg = BlockGroup(1, 0, effectiveRegion);
   bg.normalize();
 
-  if (!bg.solve(boop)) {
+  if (!Tile(bg, boop)) {
     return false;
   }
 
   return true;
 }
+
+bool Grid::Tile(BlockGroup &region, vector<BlockGroup> &pieces) {
+  // A lone piece is placed faster than its key is built.
+  if (tilecache_ == nullptr || pieces.size() < 2)
+    return region.solve(pieces, tiler_);
+  return tilecache_->Solve(region, pieces, tiler_);
+}
@@ -0,0 +1,305 @@
+#include "gridtext.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include "blockgroup.h"
+#include "util.h"
+
+namespace {
+
+// Cell kinds, indexed by SymbolKind.
+const char kKinds[] = {'.', 'S', 'E', 'o', 'b', '*', 't', 'y', '#'};
+static_assert(sizeof(kKinds) == static_cast<int>(SymbolKind::kCount),
+              "one character per SymbolKind");
+
+const char kDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+int Digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 10;
+  return -1;
+}
+
+int KindIndex(char c) {
+  for (int k = 0; k < (int)sizeof(kKinds); k++)
+    if (kKinds[k] == c)
+      return k;
+  return -1;
+}
+
+char *WriteInt(char *w, int x) { return std::to_chars(w, w + 12, x).ptr; }
+
+bool ReadInt(const char *&p, const char *end, int &x) {
+  auto r = std::from_chars(p, end, x);
+  if (r.ec != std::errc())
+    return false;
+  p = r.ptr;
+  return true;
+}
+
+bool Expect(const char *&p, const char *end, const char *word) {
+  size_t n = std::strlen(word);
+  if ((size_t)(end - p) < n || std::memcmp(p, word, n) != 0)
+    return false;
+  p += n;
+  return true;
+}
+
+// The end of a line: an optional '\r', then '\n' or the end of the text.
+bool EndLine(const char *&p, const char *end) {
+  if (p < end && *p == '\r')
+    p++;
+  if (p == end)
+    return true;
+  if (*p != '\n')
+    return false;
+  p++;
+  return true;
+}
+
+// A block cell, waiting for its shape from the block lines.
+struct BlockCell {
+  int i, j;
+  int slot;
+};
+
+struct Shape {
+  bool oriented;
+  bool sub;
+  vector<pair<int, int>> squares;
+};
+
+bool Parse(const char *&p, const char *end, Grid &g) {
+  int rows, cols;
+  if (!Expect(p, end, "panel ") || !ReadInt(p, end, rows) ||
+      !Expect(p, end, " ") || !ReadInt(p, end, cols) || !EndLine(p, end))
+    return false;
+  if (rows <= 0 || cols <= 0 || rows > 4096 || cols > 4096)
+    return false;
+
+  vector<vector<std::shared_ptr<Entity>>> v(
+      rows, vector<std::shared_ptr<Entity>>(cols));
+  vector<BlockCell> blocks;
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      if (end - p < 4)
+        return false;
+      int kind = KindIndex(p[0]);
+      int color = Digit(p[1]);
+      int arg = Digit(p[2]);
+      char path = p[3];
+      if (kind < 0 || color < 0 || color >= kPaletteSize || arg < 0 ||
+          std::strchr("_+@!", path) == nullptr || path == 0)
+        return false;
+      p += 4;
+      if (j + 1 < cols && !Expect(p, end, " "))
+        return false;
+
+      // A block is made once its shape is known, below. The placeholder
+      // carries the color and path state until then.
+      std::shared_ptr<Entity> e =
+          make_symbol(static_cast<SymbolKind>(kind), kPalette[color], arg);
+      e->is_path_ = path == '+' || path == '@';
+      e->is_path_occupied_ = path == '@' || path == '!';
+      v[i][j] = e;
+      if (static_cast<SymbolKind>(kind) == SymbolKind::kBlock)
+        blocks.push_back({i, j, arg});
+    }
+    if (!EndLine(p, end))
+      return false;
+  }
+
+  std::map<int, Shape> shapes;
+  while (!Expect(p, end, "end")) {
+    int slot;
+    Shape s;
+    if (!Expect(p, end, "block ") || !ReadInt(p, end, slot) ||
+        !Expect(p, end, " ") || end - p < 2)
+      return false;
+    s.oriented = p[0] == 'o';
+    s.sub = p[1] == 's';
+    p += 2;
+    while (Expect(p, end, " ")) {
+      int x, y;
+      if (!ReadInt(p, end, x) || !Expect(p, end, ",") || !ReadInt(p, end, y))
+        return false;
+      s.squares.push_back({x, y});
+    }
+    if (!EndLine(p, end) || s.squares.empty())
+      return false;
+    shapes[slot] = s;
+  }
+  if (!EndLine(p, end))
+    return false;
+
+  for (auto &b : blocks) {
+    auto it = shapes.find(b.slot);
+    if (it == shapes.end())
+      return false;
+    std::shared_ptr<Entity> &e = v[b.i][b.j];
+    auto bg = std::make_shared<BlockGroup>(it->second.oriented, it->second.sub,
+                                           it->second.squares, e->color_);
+    bg->is_path_ = e->is_path_;
+    bg->is_path_occupied_ = e->is_path_occupied_;
+    e = bg;
+  }
+  g = Grid(v);
+  return true;
+}
+
+} // namespace
+
+bool AppendGridText(const Grid &g, string &out) {
+  if (g.blocks_.size() > sizeof(kDigits) - 1)
+    return false; // a slot is one base 36 digit
+  // An upper bound on the text, so out grows once: the header, five
+  // characters a cell, and for a block its line with up to 24 characters a
+  // square.
+  size_t bound = 32 + (size_t)g.m_ * (g.n_ * 5 + 1) + 8;
+  vector<const BlockGroup *> shapes;
+  for (auto p : g.blocks_) {
+    const BlockGroup *bg = symbol_cast<BlockGroup>(g.board_[p.first][p.second]);
+    shapes.push_back(bg);
+    if (bg != nullptr)
+      bound += 32 + bg->pairs.size() * 24;
+  }
+
+  size_t at = out.size();
+  out.resize(at + bound);
+  char *w = out.data() + at;
+
+  std::memcpy(w, "panel ", 6);
+  w = WriteInt(w + 6, g.m_);
+  *w++ = ' ';
+  w = WriteInt(w, g.n_);
+  *w++ = '\n';
+
+  int slot = 0;
+  for (int i = 0; i < g.m_; i++) {
+    for (int j = 0; j < g.n_; j++) {
+      const Cell &c = g.CellAt({i, j});
+      bool path = g.IsPath({i, j}), occupied = g.IsOccupied({i, j});
+      int arg = c.arg;
+      if (c.kind == SymbolKind::kBlock)
+        arg = slot++; // g.blocks_ is in the same row-major order
+      *w++ = kKinds[static_cast<int>(c.kind)];
+      *w++ = kDigits[c.color % 36];
+      *w++ = kDigits[arg % 36];
+      *w++ = occupied ? (path ? '@' : '!') : (path ? '+' : '_');
+      *w++ = j + 1 < g.n_ ? ' ' : '\n';
+    }
+  }
+
+  slot = 0;
+  for (const BlockGroup *bg : shapes) {
+    if (bg == nullptr) {
+      slot++;
+      continue;
+    }
+    std::memcpy(w, "block ", 6);
+    w = WriteInt(w + 6, slot++);
+    *w++ = ' ';
+    *w++ = bg->oriented ? 'o' : '-';
+    *w++ = bg->sub ? 's' : '-';
+    for (auto &q : bg->pairs) {
+      *w++ = ' ';
+      w = WriteInt(w, q.first);
+      *w++ = ',';
+      w = WriteInt(w, q.second);
+    }
+    *w++ = '\n';
+  }
+  std::memcpy(w, "end\n", 4);
+  w += 4;
+  out.resize(w - out.data());
+  return true;
+}
+
+bool ParseGridText(const char *&p, const char *end, Grid &g) {
+  while (p < end && (*p == '\n' || *p == '\r' || *p == ' '))
+    p++;
+  const char *start = p;
+  if (p < end && Parse(p, end, g))
+    return true;
+  p = start;
+  return false;
+}
+
+GridTextWriter::GridTextWriter() : file_(nullptr), ok_(false) {}
+
+GridTextWriter::~GridTextWriter() {
+  if (file_ != nullptr)
+    Close();
+}
+
+bool GridTextWriter::Open(const string &path) {
+  if (file_ != nullptr)
+    Close();
+  file_ = std::fopen(path.c_str(), "wb");
+  ok_ = file_ != nullptr;
+  buffer_.clear();
+  buffer_.reserve(1 << 20);
+  return ok_;
+}
+
+void GridTextWriter::Write(const Grid &g) {
+  if (!AppendGridText(g, buffer_))
+    ok_ = false;
+  if (buffer_.size() >= (1 << 20))
+    Flush();
+}
+
+void GridTextWriter::Flush() {
+  if (file_ != nullptr && !buffer_.empty())
+    ok_ = std::fwrite(buffer_.data(), 1, buffer_.size(), file_) ==
+              buffer_.size() &&
+          ok_;
+  buffer_.clear(); // keeps its capacity
+}
+
+bool GridTextWriter::Close() {
+  if (file_ == nullptr)
+    return false;
+  Flush();
+  ok_ = std::fclose(file_) == 0 && ok_;
+  file_ = nullptr;
+  return ok_;
+}
+
+GridTextReader::GridTextReader() : at_(nullptr) {}
+
+bool GridTextReader::Open(const string &path) {
+  text_.clear();
+  at_ = nullptr;
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    return false;
+  char buf[1 << 16];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof buf, f)) > 0)
+    text_.append(buf, n);
+  std::fclose(f);
+  at_ = text_.data();
+  return true;
+}
+
+bool GridTextReader::Next(Grid &g) {
+  if (at_ == nullptr)
+    return false;
+  return ParseGridText(at_, text_.data() + text_.size(), g);
+}
+
+bool GridTextReader::Failed() const {
+  if (at_ == nullptr)
+    return true;
+  const char *p = at_, *end = text_.data() + text_.size();
+  while (p < end && (*p == '\n' || *p == '\r' || *p == ' '))
+    p++;
+  return p != end;
+}
@@ -0,0 +1,355 @@
+#include "pathstate.h"
+
+#include "blockgroup.h"
+#include "util.h"
+
+using std::make_pair;
+
+PathState::PathState()
+    : grid_(nullptr), fallback_(false), regionrules_(false), depth_(0),
+      touches_(0), uncovered_(0), unsatisfied_(0), overfull_(0) {}
+
+void PathState::Reset(Grid &g, pair<int, int> start) {
+  grid_ = &g;
+  start_ = start;
+
+  // Cancels need the full recursive check.
+  fallback_ = !g.cancels_.empty();
+  regionrules_ = !g.blobs_.empty() || !g.stars_.empty() ||
+                 !g.blocks_.empty() || !g.triangles_.empty();
+
+  depth_ = 0;
+  if (levels_.empty())
+    levels_.resize(1);
+  Label(levels_[0]);
+
+  path_.clear();
+  split_.clear();
+  touches_ = 0;
+
+  sides_.assign(g.m_ * g.n_, 0);
+  uncovered_ = g.dots_.size();
+  unsatisfied_ = 0;
+  overfull_ = 0;
+  for (auto i : g.triangles_)
+    if (g.CellAt(i).arg != 0)
+      unsatisfied_++;
+}
+
+bool PathState::OnFrame(pair<int, int> p) const {
+  if (p.first % 2 != 0 || p.second % 2 != 0)
+    return false;
+  return p.first == 0 || p.second == 0 || p.first == grid_->m_ - 1 ||
+         p.second == grid_->n_ - 1;
+}
+
+void PathState::Push(pair<int, int> p) {
+  path_.push_back(p);
+  Touch(p, 1);
+
+  // Reaching the frame again closes a loop through the frame. Regions are
+  // told apart by the edges between them, so stopping on an edge end whose
+  // other lattice point is on the frame cuts the board just the same. The
+  // line also closes a loop on itself when it stops on an edge whose other
+  // lattice point it has already drawn (or reaches the far end of an edge it
+  // started on): p then touches a line cell besides the one before it.
+  bool split = false;
+  if (OnFrame(p)) {
+    if (touches_ > 0 && path_.size() >= 2) {
+      depth_++;
+      if ((int)levels_.size() <= depth_)
+        levels_.resize(depth_ + 1);
+      Split(levels_[depth_ - 1], levels_[depth_], path_[path_.size() - 2]);
+      split = true;
+    }
+    touches_++;
+  } else if (touches_ > 0 && path_.size() >= 2 &&
+             grid_->KindAt(p) == SymbolKind::kEnd) {
+    pair<int, int> prev = path_[path_.size() - 2];
+    pair<int, int> far = {2 * p.first - prev.first, 2 * p.second - prev.second};
+    if (grid_->Inside(far) && OnFrame(far)) {
+      depth_++;
+      if ((int)levels_.size() <= depth_)
+        levels_.resize(depth_ + 1);
+      Split(levels_[depth_ - 1], levels_[depth_], p);
+      split = true;
+    }
+  }
+  if (!split && Closes(p)) {
+    // Rare, and the loop need not cross any one known edge: label afresh.
+    depth_++;
+    if ((int)levels_.size() <= depth_)
+      levels_.resize(depth_ + 1);
+    Label(levels_[depth_]);
+    split = true;
+  }
+  split_.push_back(split);
+}
+
+bool PathState::Closes(pair<int, int> p) const {
+  const int dx[4] = {01, 00, -1, 00};
+  const int dy[4] = {00, 01, 00, -1};
+  if (path_.size() < 3)
+    return false;
+  pair<int, int> prev = path_[path_.size() - 2];
+  for (int d = 0; d < 4; d++) {
+    pair<int, int> q = {p.first + dx[d], p.second + dy[d]};
+    if (q != prev && grid_->Inside(q) && grid_->IsOccupied(q))
+      return true;
+  }
+  return false;
+}
+
+void PathState::Pop() {
+  pair<int, int> p = path_.back();
+  if (OnFrame(p))
+    touches_--;
+  if (split_.back())
+    depth_--;
+  Touch(p, -1);
+  path_.pop_back();
+  split_.pop_back();
+}
+
+void PathState::Touch(pair<int, int> p, int d) {
+  const int dx[4] = {01, 00, -1, 00};
+  const int dy[4] = {00, 01, 00, -1};
+
+  if (grid_->KindAt(p) == SymbolKind::kDot)
+    uncovered_ -= d;
+
+  if (!grid_->IsPath(p))
+    return;
+  for (int i = 0; i < 4; i++) {
+    pair<int, int> side = {p.first + dx[i], p.second + dy[i]};
+    if (!grid_->Inside(side))
+      continue;
+    if (grid_->KindAt(side) != SymbolKind::kTriangle)
+      continue;
+    int target = grid_->CellAt(side).arg;
+    int &count = sides_[grid_->Index(side)];
+    bool before = count == target;
+    overfull_ -= count > target;
+    count += d;
+    overfull_ += count > target;
+    bool after = count == target;
+    if (before && !after)
+      unsatisfied_++;
+    else if (!before && after)
+      unsatisfied_--;
+  }
+}
+
+// The regions of Grid::IsValid: symbol cells, split wherever the line runs
+// between them.
+void PathState::Label(Level &l) {
+  Grid &g = *grid_;
+  regions_.LabelLattice(g.m_, g.n_, g.occupied_);
+
+  l.label = regions_.label_;
+  l.regions = regions_.count_;
+  l.colors.assign(l.regions * kPaletteSize, 0);
+  l.blobs.assign(l.regions * kPaletteSize, 0);
+  l.stars.assign(l.regions * kPaletteSize, 0);
+  l.blocks.assign(l.regions, 0);
+  l.valid.assign(l.regions, -1);
+
+  for (int r = 0; r < l.regions; r++) {
+    for (const int *k = regions_.Begin(r); k != regions_.End(r); k++) {
+      const Cell &c = g.cells_[*k];
+      l.colors[r * kPaletteSize + c.color]++;
+      if (c.kind == SymbolKind::kBlob)
+        l.blobs[r * kPaletteSize + c.color]++;
+      else if (c.kind == SymbolKind::kStar)
+        l.stars[r * kPaletteSize + c.color]++;
+      else if (c.kind == SymbolKind::kBlock)
+        l.blocks[r]++;
+    }
+  }
+}
+
+// The loop just closed runs through edge e, so the two cells on either side
+// of e end up in different regions. Only the region they shared is split:
+// everything the flood from one side reaches gets a new label.
+void PathState::Split(const Level &from, Level &l, pair<int, int> e) {
+  const int dx[4] = {01, 00, -1, 00};
+  const int dy[4] = {00, 01, 00, -1};
+  Grid &g = *grid_;
+
+  l = from;
+
+  pair<int, int> a, b;
+  if (e.first % 2 == 1 && e.second % 2 == 0) {
+    a = {e.first, e.second - 1};
+    b = {e.first, e.second + 1};
+  } else if (e.first % 2 == 0 && e.second % 2 == 1) {
+    a = {e.first - 1, e.second};
+    b = {e.first + 1, e.second};
+  } else {
+    Label(l);
+    return;
+  }
+  if (!g.Inside(a) || !g.Inside(b))
+    return; // e runs along the frame, nothing is cut off
+
+  int old = l.label[g.Index(a)];
+  int r = l.regions++;
+  l.colors.resize(l.regions * kPaletteSize, 0);
+  l.blobs.resize(l.regions * kPaletteSize, 0);
+  l.stars.resize(l.regions * kPaletteSize, 0);
+  l.blocks.resize(l.regions, 0);
+  l.valid.resize(l.regions, -1);
+  l.valid[old] = -1;
+
+  queue_.clear();
+  queue_.push_back(g.Index(a));
+  l.label[queue_[0]] = r;
+  for (size_t head = 0; head < queue_.size(); head++) {
+    int now = queue_[head];
+    pair<int, int> p = {now / g.n_, now % g.n_};
+
+    const Cell &c = g.cells_[now];
+    l.colors[r * kPaletteSize + c.color]++;
+    l.colors[old * kPaletteSize + c.color]--;
+    if (c.kind == SymbolKind::kBlob) {
+      l.blobs[r * kPaletteSize + c.color]++;
+      l.blobs[old * kPaletteSize + c.color]--;
+    } else if (c.kind == SymbolKind::kStar) {
+      l.stars[r * kPaletteSize + c.color]++;
+      l.stars[old * kPaletteSize + c.color]--;
+    } else if (c.kind == SymbolKind::kBlock) {
+      l.blocks[r]++;
+      l.blocks[old]--;
+    }
+
+    for (int d = 0; d < 4; d++) {
+      pair<int, int> mid = {p.first + dx[d], p.second + dy[d]};
+      pair<int, int> next = {p.first + dx[d] * 2, p.second + dy[d] * 2};
+      if (!g.Inside(mid) || !g.Inside(next))
+        continue;
+      if (g.IsOccupied(mid))
+        continue;
+      int k = g.Index(next);
+      if (l.label[k] != old)
+        continue;
+      l.label[k] = r;
+      queue_.push_back(k);
+    }
+  }
+}
+
+bool PathState::Check() {
+  if (fallback_)
+    return grid_->IsValid(start_.first, start_.second);
+
+  if (uncovered_ > 0 || unsatisfied_ > 0)
+    return false;
+
+  for (int r = 0; r < Top().regions; r++)
+    if (!RegionValid(r))
+      return false;
+  return true;
+}
+
+bool PathState::RegionValid(int r) {
+  Level &l = levels_[depth_];
+  if (l.valid[r] >= 0)
+    return l.valid[r];
+  l.valid[r] = false;
+
+  Grid &g = *grid_;
+  const int *colors = &l.colors[r * kPaletteSize];
+  const int *blobs = &l.blobs[r * kPaletteSize];
+  const int *stars = &l.stars[r * kPaletteSize];
+
+  // Blobs: one color per region. Uncolored blobs only fail a region when
+  // they outnumber the colored ones, as in Grid::IsValid.
+  int distinct = 0, colored = 0;
+  for (int c = 1; c < kPaletteSize; c++) {
+    if (blobs[c] > 0) {
+      distinct++;
+      colored = blobs[c];
+    }
+  }
+  if (distinct > 1 || (distinct == 1 && blobs[0] > colored))
+    return false;
+
+  // Stars: exactly two symbols of the star's color.
+  for (int c = 0; c < kPaletteSize; c++)
+    if (stars[c] > 0 && colors[c] != 2)
+      return false;
+
+  if (l.blocks[r] > 0) {
+    vector<pair<int, int>> regionvec;
+    vector<BlockGroup> pieces;
+    for (int i = 1; i < g.m_; i += 2) {
+      for (int j = 1; j < g.n_; j += 2) {
+        if (l.label[g.Index({i, j})] != r)
+          continue;
+        regionvec.push_back(make_pair(j >> 1, -1 * i >> 1));
+        BlockGroup *bg = symbol_cast<BlockGroup>(g.board_[i][j]);
+        if (bg != nullptr)
+          pieces.push_back(*bg);
+      }
+    }
+    BlockGroup testregion = BlockGroup(1, 0, regionvec);
+    if (!g.Tile(testregion, pieces))
+      return false;
+  }
+  l.valid[r] = true;
+  return true;
+}
+
+bool PathState::Sealed(int r, const Bitboard &open) {
+  const int dx[4] = {01, 00, -1, 00};
+  const int dy[4] = {00, 01, 00, -1};
+  if (open_[r] >= 0)
+    return !open_[r];
+  Grid &g = *grid_;
+  const Level &l = Top();
+  open_[r] = 0;
+  for (int i = 1; i < g.m_ && !open_[r]; i += 2)
+    for (int j = 1; j < g.n_ && !open_[r]; j += 2)
+      if (l.label[g.Index({i, j})] == r)
+        for (int d = 0; d < 4; d++)
+          if (open.test(g.Index({i + dx[d], j + dy[d]})))
+            open_[r] = 1;
+  return !open_[r];
+}
+
+bool PathState::MayFail() {
+  if (fallback_ || !regionrules_)
+    return false;
+  if (unsatisfied_ > 0)
+    return true;
+  const Level &l = Top();
+  for (int r = 0; r < l.regions; r++)
+    if (l.blocks[r] > 0 || !RegionValid(r))
+      return true;
+  return false;
+}
+
+bool PathState::FinalRegionsValid(const Bitboard &open) {
+  if (fallback_ || !regionrules_)
+    return true;
+
+  Grid &g = *grid_;
+  const Level &l = Top();
+  open_.assign(l.regions, -1);
+
+  // A triangle's edges all border its region, so in a final region its
+  // count is final too.
+  for (auto t : g.triangles_)
+    if (sides_[g.Index(t)] != g.CellAt(t).arg &&
+        Sealed(l.label[g.Index(t)], open))
+      return false;
+
+  // Most regions pass, so only ask whether one is sealed once it fails,
+  // except that tiling costs more than the question.
+  for (int r = 0; r < l.regions; r++) {
+    if (l.blocks[r] > 0 ? Sealed(r, open) && !RegionValid(r)
+                        : !RegionValid(r) && Sealed(r, open))
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,292 @@
+#include "puzzlepack.h"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <memory>
+
+#include "blockgroup.h"
+#include "util.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Steps between the cells of a stored line, in Solver's order.
+const int kDx[4] = {1, 0, -1, 0};
+const int kDy[4] = {0, 1, 0, -1};
+
+size_t Align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+EntityColor ColorAt(const PackCell &c) {
+  return kPalette[c.color < kPaletteSize ? c.color : 0];
+}
+
+} // namespace
+
+Grid PackPanel::ToGrid() const {
+  if (header_ == nullptr)
+    return Grid();
+  int rows = header_->rows, cols = header_->cols;
+  vector<vector<std::shared_ptr<Entity>>> v(
+      rows, vector<std::shared_ptr<Entity>>(cols));
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      const PackCell &c = At(i, j);
+      v[i][j] = make_symbol(c.kind, ColorAt(c), c.arg);
+    }
+  }
+
+  for (int k = 0; k < header_->maxblocks; k++) {
+    const PackBlock &b = blocks_[k];
+    if (!b.used || b.row >= rows || b.col >= cols)
+      continue;
+    vector<pair<int, int>> squares;
+    for (uint64_t m = b.mask; m != 0; m &= m - 1) {
+      int bit = std::countr_zero(m);
+      squares.push_back({b.x0 + bit / 8, b.y0 + bit % 8});
+    }
+    v[b.row][b.col] = std::make_shared<BlockGroup>(
+        b.flags & kPackOriented, b.flags & kPackSub, squares,
+        ColorAt(At(b.row, b.col)));
+  }
+
+  for (int i = 0; i < rows; i++)
+    for (int j = 0; j < cols; j++)
+      v[i][j]->is_path_ = At(i, j).flags & kPackPath;
+  return Grid(v);
+}
+
+vector<pair<int, int>> PackPanel::Solution() const {
+  vector<pair<int, int>> res;
+  if (header_ == nullptr)
+    return res;
+  // The record holds steps for at most rows * cols cells, and a corrupt
+  // pack may claim more or walk off the panel.
+  int rows = header_->rows, cols = header_->cols;
+  int length = solution_->length;
+  if (length == 0 || length > rows * cols || solution_->start >= rows * cols)
+    return res;
+  const unsigned char *steps = (const unsigned char *)(solution_ + 1);
+  pair<int, int> p = {solution_->start / cols, solution_->start % cols};
+  res.push_back(p);
+  for (int k = 0; k + 1 < length; k++) {
+    int d = (steps[k / 4] >> (2 * (k % 4))) & 3;
+    p = {p.first + kDx[d], p.second + kDy[d]};
+    if (p.first < 0 || p.second < 0 || p.first >= rows || p.second >= cols)
+      return {};
+    res.push_back(p);
+  }
+  return res;
+}
+
+PuzzlePack::PuzzlePack()
+    : data_(nullptr), size_(0), header_(nullptr), index_(nullptr) {}
+
+PuzzlePack::~PuzzlePack() { Close(); }
+
+bool PuzzlePack::Open(const string &path) {
+  Close();
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(PackHeader)) {
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p != MAP_FAILED) {
+      data_ = (const unsigned char *)p;
+      size_ = st.st_size;
+    }
+  }
+  close(fd); // the mapping stays
+#else
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (f != nullptr) {
+    unsigned char buf[1 << 16];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, f)) > 0)
+      copy_.insert(copy_.end(), buf, buf + n);
+    std::fclose(f);
+  }
+  if (copy_.size() >= sizeof(PackHeader)) {
+    data_ = copy_.data();
+    size_ = copy_.size();
+  }
+#endif
+  if (data_ == nullptr)
+    return false;
+
+  const PackHeader *h = (const PackHeader *)data_;
+  uint64_t cells = (uint64_t)h->rows * h->cols;
+  bool ok = std::memcmp(h->magic, kPackMagic, sizeof kPackMagic) == 0 &&
+            cells > 0 && cells < 65536 &&
+            (h->maxblocks == 0 || (h->rows <= 255 && h->cols <= 255)) &&
+            h->blocks >= cells * sizeof(PackCell) &&
+            h->solution >= h->blocks + h->maxblocks * sizeof(PackBlock) &&
+            h->recordsize >= h->solution + sizeof(PackSolution) +
+                                 (cells + 3) / 4 &&
+            h->records % 8 == 0 && h->recordsize % 8 == 0 &&
+            h->blocks % 8 == 0 && h->solution % 2 == 0 &&
+            h->records + (uint64_t)h->count * h->recordsize <= size_ &&
+            h->index % 4 == 0 &&
+            h->index + (uint64_t)h->count * sizeof(PackEntry) <= size_;
+  if (!ok) {
+    Close();
+    return false;
+  }
+  header_ = h;
+  index_ = (const PackEntry *)(data_ + h->index);
+  return true;
+}
+
+void PuzzlePack::Close() {
+#ifndef _WIN32
+  if (data_ != nullptr)
+    munmap((void *)data_, size_);
+#endif
+  copy_.clear();
+  data_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  index_ = nullptr;
+}
+
+PackPanel PuzzlePack::Panel(size_t i) const {
+  if (i >= Size())
+    return PackPanel();
+  const unsigned char *r = data_ + header_->records + i * header_->recordsize;
+  PackPanel res;
+  res.header_ = header_;
+  res.cells_ = (const PackCell *)r;
+  res.blocks_ = (const PackBlock *)(r + header_->blocks);
+  res.solution_ = (const PackSolution *)(r + header_->solution);
+  res.entry_ = index_ + i;
+  return res;
+}
+
+PackWriter::PackWriter() : file_(nullptr), ok_(false) {}
+
+PackWriter::~PackWriter() {
+  if (file_ != nullptr)
+    Close();
+}
+
+bool PackWriter::Open(const string &path, int rows, int cols, int maxblocks) {
+  if (file_ != nullptr)
+    Close();
+  if (rows <= 0 || cols <= 0 || rows * cols >= 65536 || maxblocks < 0 ||
+      maxblocks > 65535)
+    return false;
+  if (maxblocks > 0 && (rows > 255 || cols > 255))
+    return false; // PackBlock holds its cell in a byte each
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr)
+    return false;
+
+  int cells = rows * cols;
+  std::memset(&header_, 0, sizeof header_);
+  std::memcpy(header_.magic, kPackMagic, sizeof kPackMagic);
+  header_.rows = rows;
+  header_.cols = cols;
+  header_.maxblocks = maxblocks;
+  header_.blocks = Align8(cells * sizeof(PackCell));
+  header_.solution = header_.blocks + maxblocks * sizeof(PackBlock);
+  header_.recordsize =
+      Align8(header_.solution + sizeof(PackSolution) + (cells + 3) / 4);
+  header_.records = Align8(sizeof(PackHeader));
+  entries_.clear();
+  record_.assign(header_.recordsize, 0);
+
+  // Filled in for real by Close.
+  ok_ = std::fwrite(&header_, sizeof header_, 1, file_) == 1;
+  return ok_;
+}
+
+bool PackWriter::Add(const Grid &g, const PackEntry &entry,
+                     const vector<pair<int, int>> &solution) {
+  if (file_ == nullptr || g.m_ != header_.rows || g.n_ != header_.cols ||
+      g.blocks_.size() > header_.maxblocks ||
+      solution.size() > (size_t)g.m_ * g.n_)
+    return false;
+
+  std::fill(record_.begin(), record_.end(), 0);
+  PackCell *cells = (PackCell *)record_.data();
+  for (int i = 0; i < g.m_; i++) {
+    for (int j = 0; j < g.n_; j++) {
+      const Cell &c = g.CellAt({i, j});
+      cells[g.Index({i, j})] = {c.kind, c.color, c.arg,
+                                g.IsPath({i, j}) ? kPackPath : (uint8_t)0};
+    }
+  }
+
+  PackBlock *blocks = (PackBlock *)(record_.data() + header_.blocks);
+  int k = 0;
+  for (auto p : g.blocks_) {
+    BlockGroup *bg = symbol_cast<BlockGroup>(g.board_[p.first][p.second]);
+    if (bg == nullptr)
+      continue;
+    int x0 = INT_MAX, y0 = INT_MAX;
+    for (auto &q : bg->pairs) {
+      x0 = std::min(x0, q.first);
+      y0 = std::min(y0, q.second);
+    }
+    if (x0 < INT8_MIN || y0 < INT8_MIN || x0 > INT8_MAX || y0 > INT8_MAX)
+      return false;
+    PackBlock &b = blocks[k++];
+    b.row = p.first;
+    b.col = p.second;
+    b.flags = (bg->oriented ? kPackOriented : 0) | (bg->sub ? kPackSub : 0);
+    b.used = 1;
+    b.x0 = x0;
+    b.y0 = y0;
+    for (auto &q : bg->pairs) {
+      int x = q.first - x0, y = q.second - y0;
+      if (x >= 8 || y >= 8)
+        return false;
+      b.mask |= uint64_t(1) << (x * 8 + y);
+    }
+  }
+
+  PackSolution *sol = (PackSolution *)(record_.data() + header_.solution);
+  unsigned char *steps = (unsigned char *)(sol + 1);
+  if (!solution.empty()) {
+    sol->start = g.Index(solution[0]);
+    sol->length = solution.size();
+    for (size_t s = 1; s < solution.size(); s++) {
+      int d = 0;
+      while (d < 4 && (solution[s].first - solution[s - 1].first != kDx[d] ||
+                       solution[s].second - solution[s - 1].second != kDy[d]))
+        d++;
+      if (d == 4)
+        return false; // not a line
+      steps[(s - 1) / 4] |= d << (2 * ((s - 1) % 4));
+    }
+  }
+
+  ok_ = ok_ && std::fwrite(record_.data(), record_.size(), 1, file_) == 1;
+  entries_.push_back(entry);
+  return true;
+}
+
+bool PackWriter::Close() {
+  if (file_ == nullptr)
+    return false;
+  header_.count = entries_.size();
+  header_.index =
+      header_.records + (uint64_t)header_.count * header_.recordsize;
+  if (!entries_.empty())
+    ok_ = ok_ && std::fwrite(entries_.data(), sizeof(PackEntry),
+                             entries_.size(), file_) == entries_.size();
+  ok_ = ok_ && std::fseek(file_, 0, SEEK_SET) == 0 &&
+        std::fwrite(&header_, sizeof header_, 1, file_) == 1;
+  ok_ = std::fclose(file_) == 0 && ok_;
+  file_ = nullptr;
+  return ok_;
+}
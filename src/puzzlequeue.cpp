@@ -0,0 +1,84 @@
+#include "puzzlequeue.h"
+
+#include "solver.h"
+
+PuzzleQueue::PuzzleQueue() : stop_(false) {
+  // Seeded apart from the game's own RandGrid, which is seeded from the
+  // clock in the same second.
+  generator_.gen = mt19937(generator_.rd());
+  for (int f = 0; f < kPuzzleFamilies; f++)
+    enabled_[f] = true;
+  producer_ = std::thread(&PuzzleQueue::Run, this);
+}
+
+PuzzleQueue::~PuzzleQueue() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  producer_.join();
+}
+
+void PuzzleQueue::Enable(PuzzleFamily family, bool on) {
+  enabled_[family] = on;
+  if (on)
+    Notify();
+}
+
+bool PuzzleQueue::TryPop(PuzzleFamily family, Grid &g) {
+  if (!ready_[family].TryPop(g))
+    return false;
+  Notify();
+  return true;
+}
+
+void PuzzleQueue::Notify() {
+  // Taking lock_ orders this with a producer that just found every queue
+  // full and is about to sleep, so the wakeup cannot be missed.
+  { std::lock_guard<std::mutex> guard(lock_); }
+  wake_.notify_one();
+}
+
+void PuzzleQueue::Run() {
+  Solver solver;
+  while (true) {
+    // Fill the emptiest enabled queue first, so a family just dealt is
+    // topped up before the others.
+    int next = -1;
+    for (int f = 0; f < kPuzzleFamilies; f++)
+      if (enabled_[f] && !ready_[f].Full() &&
+          (next < 0 || ready_[f].Size() < ready_[next].Size()))
+        next = f;
+
+    if (next < 0) {
+      std::unique_lock<std::mutex> guard(lock_);
+      wake_.wait(guard, [this] {
+        if (stop_)
+          return true;
+        for (int f = 0; f < kPuzzleFamilies; f++)
+          if (enabled_[f] && !ready_[f].Full())
+            return true;
+        return false;
+      });
+      if (stop_)
+        return;
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (stop_)
+        return;
+    }
+
+    Grid g = generator_.randFamily((PuzzleFamily)next);
+    // Every generator draws its symbols around a line, so the panel should
+    // always be solvable. Checked anyway: dealing one that is not would
+    // leave the player stuck.
+    solver.Set(g);
+    if (solver.Solve().empty())
+      continue;
+    ready_[next].TryPush(std::move(g));
+  }
+}
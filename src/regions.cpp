@@ -0,0 +1,91 @@
+#include "regions.h"
+
+Regions::Regions() : m_(0), n_(0), count_(0) {}
+
+void Regions::Start(int m, int n) {
+  m_ = m;
+  n_ = n;
+  count_ = 0;
+  parent_.assign(m * n, -1);
+  label_.assign(m * n, -1);
+}
+
+int Regions::Find(int x) {
+  while (parent_[x] != x) {
+    parent_[x] = parent_[parent_[x]];
+    x = parent_[x];
+  }
+  return x;
+}
+
+// The smaller index stays the root, so every root is the first cell of its
+// region in row-major order.
+void Regions::Union(int a, int b) {
+  a = Find(a);
+  b = Find(b);
+  if (a == b)
+    return;
+  if (a < b)
+    parent_[b] = a;
+  else
+    parent_[a] = b;
+}
+
+void Regions::LabelCells(int m, int n, const Bitboard &blocked) {
+  Start(m, n);
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      int k = i * n + j;
+      if (blocked.test(k))
+        continue;
+      parent_[k] = k;
+      if (j > 0 && parent_[k - 1] >= 0)
+        Union(k, k - 1);
+      if (i > 0 && parent_[k - n] >= 0)
+        Union(k, k - n);
+    }
+  }
+  Finish();
+}
+
+void Regions::LabelLattice(int m, int n, const Bitboard &blocked) {
+  Start(m, n);
+  for (int i = 1; i < m; i += 2) {
+    for (int j = 1; j < n; j += 2) {
+      int k = i * n + j;
+      parent_[k] = k;
+      if (j > 1 && !blocked.test(k - 1))
+        Union(k, k - 2);
+      if (i > 1 && !blocked.test(k - n))
+        Union(k, k - 2 * n);
+    }
+  }
+  Finish();
+}
+
+void Regions::Finish() {
+  int size = m_ * n_;
+  for (int k = 0; k < size; k++) {
+    if (parent_[k] < 0)
+      continue;
+    int r = Find(k);
+    if (r == k)
+      label_[k] = count_++;
+    else
+      label_[k] = label_[r];
+  }
+
+  // Bucket the cells by region, keeping row-major order inside each.
+  begin_.assign(count_ + 1, 0);
+  for (int k = 0; k < size; k++)
+    if (label_[k] >= 0)
+      begin_[label_[k] + 1]++;
+  for (int r = 0; r < count_; r++)
+    begin_[r + 1] += begin_[r];
+  cells_.resize(begin_[count_]);
+  vector<int> &next = parent_; // no longer needed as a forest
+  next.assign(begin_.begin(), begin_.end() - 1);
+  for (int k = 0; k < size; k++)
+    if (label_[k] >= 0)
+      cells_[next[label_[k]]++] = k;
+}
@@ -2,54 +2,37 @@
 
 #include <ctime>
 #include <iostream>
-using std::pair;
+#include <mutex>
 
-Solver::Solver() { solution_ = vector<pair<int, int>>(); }
+#include "alloctrack.h"
+using std::pair;
 
-Solver::Solver(Grid &g) {
-  grid_ = g;
+Solver::Solver()
+    : callstopath_(0), reachprune_(true), dotprune_(true), stamp_(0),
+      closeprune_(true), triprune_(true), threads_(1), splitdepth_(12),
+      seed_(0), randomorder_(true), stop_(nullptr), mode_(kFirst), found_(0),
+      limit_(0), done_(false) {
   solution_ = vector<pair<int, int>>();
 }
 
+Solver::Solver(Grid &g) : Solver() { grid_ = g; }
+
 void Solver::Set(Grid &g) {
   grid_ = g;
   solution_.clear();
 }
 
-void Solver::Path(pair<int, int> src, pair<int, int> prev) {
-  callstopath_++;
-  // cout << "[" << src.first << " " << src.second << "]\n";
-  if (solution_.size() > 0)
-    return;
-  if ((grid_.ends_).find(src) != (grid_.ends_).end()) {
-    grid_.board_[src.first][src.second]->is_path_occupied_ = true;
-    // cout << "ENDPOINT " << src.first << " " << src.second << endl;
-    // grid.disp();
-
-    bool check = grid_.IsValid(origin_.first, origin_.second);
-    // cout << (check ? "PASSED\n" : "FAILED\n");
-    if (check) {
-      // cout << "SOLUTION FOUND" << endl;
-      vis_.insert({src, prev});
-      // for (auto i : vis) cout << "[" << i.first.first << " " <<
-      // i.first.second << "] [" << i.second.first << " " << i.second.second <<
-      // "]\n";
-      while (vis_.find(src) != vis_.end() && vis_.at(src) != src) {
-        // cout << src.first << " " << src.second << endl;
-        solution_.push_back(src);
-        src = vis_.at(src);
-      }
-      solution_.push_back(src);
-      reverse(solution_.begin(), solution_.end());
-    }
-
-    grid_.board_[src.first][src.second]->is_path_occupied_ = false;
-    return;
-  }
-
-  // Basic pruning action
-  // This can be toggled by changing the loop constraints.
+// Basic pruning action
+// This can be toggled by changing the loop constraints.
+// Only once the line has touched the frame does reaching it again close off
+// a region for good. Before that, both sides are still one open region and
+// failing it proves nothing. The closure prune checks the same regions once
+// they are drawn, without ValidateRegion's allocations, so this only runs
+// with it off.
 
+bool Solver::Prune(pair<int, int> src) {
+  if (!state_.Touched())
+    return false;
   for (int ii = 0; ii < 4; ii++) {
     pair<int, int> x0 = {src.first + dx[(ii + 0) % 4],
                          src.second + dy[(ii + 0) % 4]};
@@ -60,15 +43,12 @@ void Solver::Path(pair<int, int> src, pair<int, int> prev) {
     pair<int, int> x3 = {src.first + dx[(ii + 3) % 4],
                          src.second + dy[(ii + 3) % 4]};
     bool blocked0 = !grid_.Inside(x0);
-    bool blocked1 = !grid_.Inside(x1) ||
-                    grid_.board_[x1.first][x1.second]->is_path_occupied_;
+    bool blocked1 = !grid_.Inside(x1) || grid_.IsOccupied(x1);
     // bool blocked2 = !grid.inside(x2);
-    bool blocked3 = !grid_.Inside(x3) ||
-                    grid_.board_[x3.first][x3.second]->is_path_occupied_;
-
-    vector<pair<int, int>> banned({src, x0});
+    bool blocked3 = !grid_.Inside(x3) || grid_.IsOccupied(x3);
 
     if (blocked0 && !blocked1 && !blocked3) {
+      vector<pair<int, int>> banned({src, x0});
       // cout << "BLOCKED!!!  " << src.first << " " << src.second << endl;
       // grid.disp();
       bool r1 = grid_.ValidateRegion(x1.first, x1.second, banned);
@@ -76,59 +56,470 @@ void Solver::Path(pair<int, int> src, pair<int, int> prev) {
 
       if (!r1 && !r3) {
         // cout << "INVALID" << endl;
-        return;
+        return true;
       }
       break;
     }
   }
+  return false;
+}
+
+void Solver::Masks() {
+  int size = grid_.m_ * grid_.n_;
+  endmask_ = Bitboard(size);
+  notfirst_ = Bitboard(size);
+  notlast_ = Bitboard(size);
+  reach_ = Bitboard(size);
+  next_ = Bitboard(size);
+  for (auto e : grid_.ends_)
+    endmask_.set(grid_.Index(e));
+  // A cancel may erase a dot or a triangle, so neither prune applies.
+  dotmask_ = Bitboard(size);
+  tris_.clear();
+  if (grid_.cancels_.empty()) {
+    for (auto d : grid_.dots_)
+      dotmask_.set(grid_.Index(d));
+    tris_.assign(grid_.triangles_.begin(), grid_.triangles_.end());
+  }
+  cuts_ = false;
+  for (int i = 0; i < grid_.m_; i++)
+    for (int j = 0; j < grid_.n_; j++)
+      if ((i % 2 == 0 || j % 2 == 0) && !grid_.IsPath({i, j}))
+        cuts_ = true;
+  stamp_ = 0;
+  seen_.assign(size, 0);
+  order_.resize(size);
+  low_.resize(size);
+  dotsbelow_.resize(size);
+  endsbelow_.resize(size);
+  for (int k = 0; k < size; k++) {
+    if (k % grid_.n_ != 0)
+      notfirst_.set(k);
+    if (k % grid_.n_ != grid_.n_ - 1)
+      notlast_.set(k);
+  }
+}
 
-  vis_.insert({src, prev});
-  grid_.board_[src.first][src.second]->is_path_occupied_ = true;
+// Grow the cells reachable from src one step in every direction at a time,
+// through cells a line may pass that it does not occupy yet, until nothing
+// new is reached (or, with stop, an end point turns up). Leaves them in
+// reach_ and says whether an end point is among them.
+bool Solver::Flood(pair<int, int> src, bool stop) {
+  int n = grid_.n_, words = reach_.words_.size();
+  const Bitboard &path = grid_.pathable_, &occupied = grid_.occupied_;
+  reach_.clear();
+  reach_.set(grid_.Index(src));
+  bool end = false;
+  while (true) {
+    bool grew = false;
+    for (int w = 0; w < words; w++) {
+      uint64_t r = reach_.words_[w];
+      uint64_t g = r | (reach_.shifted(w, 1) & notfirst_.words_[w]) |
+                   (reach_.shifted(w, -1) & notlast_.words_[w]) |
+                   reach_.shifted(w, n) | reach_.shifted(w, -n);
+      g = r | (g & path.words_[w] & ~occupied.words_[w]);
+      next_.words_[w] = g;
+      grew |= g != r;
+      end |= (g & endmask_.words_[w]) != 0;
+    }
+    std::swap(reach_.words_, next_.words_);
+    if (!grew || (end && stop))
+      return end;
+  }
+}
 
-  srand(time(0));
-  int offset = rand() % 4;
+bool Solver::Sealed(pair<int, int> src) { return !Flood(src, true); }
 
-  for (int ii = 0; ii < 4; ii++) {
-    int i = (ii + offset) % 4;
-    pair<int, int> next = {src.first + dx[i], src.second + dy[i]};
-    if (!grid_.Inside(next))
+// The free cells and src form a graph. End points stay out of it: a line
+// stops at one, so an end only counts for the cells next to it
+// (endsbelow_). A depth-first search from src numbers the cells in order_
+// and finds, for each, the lowest number reachable from its subtree (low_).
+// When low_[c] >= order_[v] for a child c of v, the subtree of c hangs off
+// the rest of the graph by v alone. For v = src, every child's subtree is
+// its own piece once src is drawn, and the line enters just one of them.
+bool Solver::Stranded(pair<int, int> src) {
+  int n = grid_.n_, root = grid_.Index(src);
+  const Bitboard &path = grid_.pathable_, &occupied = grid_.occupied_;
+  int left = 0; // dots the line still has to cover, src aside
+  for (size_t w = 0; w < dotmask_.words_.size(); w++)
+    left += std::popcount(dotmask_.words_[w] & ~occupied.words_[w] &
+                          ~endmask_.words_[w]);
+  left -= dotmask_.test(root) && !occupied.test(root);
+  if (left <= 0)
+    return false;
+
+  stamp_++;
+  int time = 0, pieces = 0; // pieces of src's that hold dots
+  seen_[root] = stamp_;
+  order_[root] = low_[root] = time++;
+  dotsbelow_[root] = endsbelow_[root] = 0;
+  dfs_.clear();
+  dfs_.push_back({root, 0});
+  while (!dfs_.empty()) {
+    int v = dfs_.back().first;
+    if (dfs_.back().second < 4) {
+      int d = dfs_.back().second++;
+      int i = v / n + dx[d], j = v % n + dy[d];
+      if (i < 0 || j < 0 || i >= grid_.m_ || j >= n)
+        continue;
+      int u = i * n + j;
+      if (!path.test(u) || occupied.test(u))
+        continue;
+      if (endmask_.test(u)) {
+        endsbelow_[v]++;
+        continue;
+      }
+      if (seen_[u] == stamp_) {
+        low_[v] = std::min(low_[v], order_[u]);
+        continue;
+      }
+      seen_[u] = stamp_;
+      order_[u] = low_[u] = time++;
+      dotsbelow_[u] = dotmask_.test(u);
+      endsbelow_[u] = 0;
+      dfs_.push_back({u, 0});
       continue;
-    if (!grid_.board_[next.first][next.second]->is_path_)
+    }
+
+    dfs_.pop_back();
+    if (dfs_.empty())
+      break;
+    int p = dfs_.back().first;
+    low_[p] = std::min(low_[p], low_[v]);
+    if (low_[v] >= order_[p] && dotsbelow_[v] > 0) {
+      if (endsbelow_[v] == 0)
+        return true; // in and never out again
+      if (p == root && ++pieces > 1)
+        return true; // dots on two sides of the head
+    }
+    dotsbelow_[p] += dotsbelow_[v];
+    endsbelow_[p] += endsbelow_[v];
+  }
+  return dotsbelow_[root] < left; // some dot cannot be reached at all
+}
+
+// Free cells are sealed off by a closed wall of line cells and the frame.
+// Without cuts, that wall only closes when PathState splits a region: when
+// the line reaches the frame again, or stops on an edge end next to the
+// frame or its own trail. Only then can a region become final. Cuts can
+// wall off free cells at any step.
+bool Solver::Closes() {
+  if (state_.Overfull())
+    return true;
+  if (!(state_.Closed() || cuts_) || !state_.MayFail())
+    return false;
+  Flood(state_.Line().back(), false);
+  return !state_.FinalRegionsValid(reach_);
+}
+
+// A side is an edge cell, passed from one of its lattice points to the
+// other. The line can enter it from the head or from a free point that is not
+// an end point (the line stops at those), and leave it to a free point. An
+// end point on the side itself needs no way out.
+bool Solver::Live(pair<int, int> e, pair<int, int> head) {
+  if (!grid_.IsPath(e) || grid_.IsOccupied(e))
+    return false;
+  int v = e.first % 2; // 1 for a side between two points of a column
+  pair<int, int> a = {e.first - v, e.second - (1 - v)};
+  pair<int, int> b = {e.first + v, e.second + (1 - v)};
+  auto free = [&](pair<int, int> p) {
+    return grid_.Inside(p) && grid_.IsPath(p) && !grid_.IsOccupied(p);
+  };
+  auto entry = [&](pair<int, int> p) {
+    return p == head || (free(p) && grid_.KindAt(p) != SymbolKind::kEnd);
+  };
+  if (grid_.KindAt(e) == SymbolKind::kEnd)
+    return entry(a) || entry(b);
+  return (entry(a) && free(b)) || (entry(b) && free(a));
+}
+
+bool Solver::Starved(pair<int, int> head, int &forced) {
+  forced = -1;
+  for (auto t : tris_) {
+    int target = grid_.CellAt(t).arg, used = 0, live = 0;
+    for (int d = 0; d < 4; d++) {
+      pair<int, int> e = {t.first + dx[d], t.second + dy[d]};
+      if (grid_.IsPath(e) && grid_.IsOccupied(e))
+        used++;
+      else if (Live(e, head))
+        live++;
+    }
+    if (used > target || used + live < target)
+      return true;
+    if (live == 0 || used + live > target)
       continue;
-    if (vis_.find(next) != vis_.end())
+    // Every live side is needed. One next to the head is entered from the
+    // head now or never, unless it is an end point: the line can still
+    // finish there from its other lattice point.
+    for (int d = 0; d < 4; d++) {
+      pair<int, int> e = {t.first + dx[d], t.second + dy[d]};
+      if (grid_.KindAt(e) == SymbolKind::kEnd)
+        continue;
+      int k = 0;
+      while (k < 4 && (head.first + dx[k] != e.first ||
+                       head.second + dy[k] != e.second))
+        k++;
+      if (k == 4 || !Live(e, head))
+        continue;
+      if (forced >= 0 && forced != k)
+        return true; // two ways out of one cell
+      forced = k;
+    }
+  }
+  return false;
+}
+
+void Solver::Enter(pair<int, int> src) {
+  callstopath_++;
+  // cout << "[" << src.first << " " << src.second << "]\n";
+  if (done_)
+    return;
+  if (stop_ != nullptr && stop_->load(std::memory_order_relaxed))
+    return;
+  if (grid_.KindAt(src) == SymbolKind::kEnd) {
+    grid_.SetOccupied(src, true);
+    state_.Push(src);
+    // cout << "ENDPOINT " << src.first << " " << src.second << endl;
+    // grid.disp();
+
+    bool check = state_.Check();
+    // cout << (check ? "PASSED\n" : "FAILED\n");
+    if (check) {
+      // cout << "SOLUTION FOUND" << endl;
+      found_++;
+      if (mode_ == kFirst) {
+        solution_ = state_.Line();
+        done_ = true;
+      } else if (mode_ == kEach && !each_(state_.Line())) {
+        done_ = true;
+      }
+      if (limit_ > 0 && found_ >= limit_)
+        done_ = true;
+    }
+
+    state_.Pop();
+    grid_.SetOccupied(src, false);
+    return;
+  }
+
+  if (reachprune_ && Sealed(src))
+    return;
+  if (dotprune_ && Stranded(src))
+    return;
+  if (!closeprune_ && Prune(src))
+    return;
+
+  grid_.SetOccupied(src, true);
+  state_.Push(src);
+  int forced = -1;
+  if ((triprune_ && Starved(src, forced)) || (closeprune_ && Closes())) {
+    state_.Pop();
+    grid_.SetOccupied(src, false);
+    return;
+  }
+  if (forced >= 0)
+    stack_.push_back({src, (forced + 1) % 4, 3}); // forced is all that's left
+  else
+    stack_.push_back({src, FirstDirection(), 0});
+}
+
+void Solver::Path(pair<int, int> src) {
+  stack_.clear();
+  Enter(src);
+  while (!stack_.empty()) {
+    Frame &f = stack_.back();
+    if (f.tried == 4) {
+      state_.Pop();
+      grid_.SetOccupied(f.cell, false);
+      stack_.pop_back();
       continue;
-    Path(next, src);
+    }
+    int i = (f.tried++ + f.offset) % 4;
+    pair<int, int> next = {f.cell.first + dx[i], f.cell.second + dy[i]};
+    // The line is exactly the occupied cells, so they are the visited set.
+    if (grid_.Inside(next) && grid_.IsPath(next) && !grid_.IsOccupied(next))
+      Enter(next); // may push, so f is not used after this
   }
-  vis_.erase(vis_.find(src));
-  grid_.board_[src.first][src.second]->is_path_occupied_ = false;
 }
 
+void Solver::Seed() { rng_.seed(seed_ != 0 ? seed_ : time(0)); }
+
 vector<pair<int, int>> Solver::Solve() {
   // cout << "SOLVING" << endl;
+  AllocScope alloc(kAllocSolve);
+  mode_ = kFirst;
+  limit_ = 0;
+  if (threads_ > 1)
+    return SolveParallel();
+  Search();
+  return solution_;
+}
+
+long long Solver::CountSolutions(long long limit) {
+  mode_ = kCount;
+  limit_ = limit;
+  Search();
+  return found_;
+}
+
+long long Solver::ForEachSolution(
+    std::function<bool(const vector<pair<int, int>> &)> f) {
+  mode_ = kEach;
+  limit_ = 0;
+  each_ = f;
+  Search();
+  each_ = nullptr;
+  return found_;
+}
+
+void Solver::Search() {
   callstopath_ = 0;
+  found_ = 0;
+  done_ = false;
   solution_.clear();
+  grid_.ClearPath(); // the line is redrawn from scratch
+  Seed();
+  Masks();
+
   for (auto i : grid_.starts_) {
     origin_ = i;
+    state_.Reset(grid_, i);
     // cout << i.first << " " << i.second << endl;
-    vis_.clear();
-    vis_.insert({i, i});
-    Path(i, i);
-    if (solution_.size() > 0)
+    Path(i);
+    if (done_)
       break;
   }
+}
+
+// The top of the search tree, walked like Path. Every line that reaches
+// splitdepth_ cells, or an end point before that, becomes a task.
+void Solver::Split(pair<int, int> src, vector<pair<int, int>> &prefix,
+                   vector<vector<pair<int, int>>> &tasks) {
+  prefix.push_back(src);
+  if ((int)prefix.size() >= splitdepth_ ||
+      grid_.KindAt(src) == SymbolKind::kEnd) {
+    tasks.push_back(prefix);
+    prefix.pop_back();
+    return;
+  }
+  if ((reachprune_ && Sealed(src)) || (dotprune_ && Stranded(src)) ||
+      (!closeprune_ && Prune(src))) {
+    prefix.pop_back();
+    return;
+  }
+
+  grid_.SetOccupied(src, true);
+  state_.Push(src);
+  int forced = -1;
+  if (triprune_ && Starved(src, forced)) {
+    state_.Pop();
+    grid_.SetOccupied(src, false);
+    prefix.pop_back();
+    return;
+  }
+
+  int offset = FirstDirection();
+  for (int ii = 0; ii < 4; ii++) {
+    int i = (ii + offset) % 4;
+    if (forced >= 0 && i != forced)
+      continue;
+    pair<int, int> next = {src.first + dx[i], src.second + dy[i]};
+    if (!grid_.Inside(next))
+      continue;
+    if (!grid_.IsPath(next))
+      continue;
+    if (grid_.IsOccupied(next))
+      continue;
+    Split(next, prefix, tasks);
+  }
+  state_.Pop();
+  grid_.SetOccupied(src, false);
+  prefix.pop_back();
+}
+
+void Solver::Replay(const vector<pair<int, int>> &prefix) {
+  grid_.ClearPath();
+  solution_.clear();
+  done_ = false;
+  origin_ = prefix[0];
+  state_.Reset(grid_, origin_);
+  Masks();
+  for (size_t i = 0; i + 1 < prefix.size(); i++) {
+    grid_.SetOccupied(prefix[i], true);
+    state_.Push(prefix[i]);
+  }
+}
+
+vector<pair<int, int>> Solver::SolveParallel() {
+  callstopath_ = 0;
+  done_ = false;
+  solution_.clear();
+  grid_.ClearPath();
+  Seed();
+  Masks();
+
+  vector<vector<pair<int, int>>> tasks;
+  vector<pair<int, int>> prefix;
+  for (auto i : grid_.starts_) {
+    origin_ = i;
+    state_.Reset(grid_, i);
+    Split(i, prefix, tasks);
+  }
+
+  if (pool_ == nullptr || pool_->Size() != threads_)
+    pool_ = std::make_shared<ThreadPool>(threads_);
+
+  std::atomic<bool> stop(false);
+  std::mutex found;
+
+  // Each task seeds its own move order, so a subtree is searched the same
+  // way whichever worker picks it up.
+  unsigned base = rng_();
+
+  // One solver per worker, each drawing on its own copy of the grid.
+  vector<Solver> workers;
+  workers.reserve(threads_);
+  for (int i = 0; i < threads_; i++) {
+    workers.emplace_back(grid_);
+    workers.back().randomorder_ = randomorder_;
+    workers.back().reachprune_ = reachprune_;
+    workers.back().dotprune_ = dotprune_;
+    workers.back().closeprune_ = closeprune_;
+    workers.back().triprune_ = triprune_;
+    workers.back().stop_ = &stop;
+  }
+
+  for (size_t index = 0; index < tasks.size(); index++) {
+    pool_->Submit([&workers, &stop, &found, &tasks, base, index, this] {
+      if (stop.load(std::memory_order_relaxed))
+        return;
+      const vector<pair<int, int>> &t = tasks[index];
+      Solver &w = workers[ThreadPool::WorkerIndex()];
+      w.rng_.seed(base + index);
+      w.Replay(t);
+      w.Path(t.back());
+      if (w.solution_.empty())
+        return;
+      std::lock_guard<std::mutex> guard(found);
+      if (solution_.empty())
+        solution_ = w.solution_;
+      stop = true;
+    });
+  }
+  pool_->Wait();
+
+  for (auto &w : workers)
+    callstopath_ += w.callstopath_;
   return solution_;
 }
 
 string Solver::ToString() {
-  for (auto i : grid_.board_) {
-    for (auto j : i)
-      j->is_path_occupied_ = false;
-  }
+  grid_.ClearPath();
   for (auto i : solution_)
-    grid_.board_[i.first][i.second]->is_path_occupied_ = true;
+    grid_.SetOccupied(i, true);
   string res = grid_.ToString();
   for (auto i : solution_)
-    grid_.board_[i.first][i.second]->is_path_occupied_ = false;
+    grid_.SetOccupied(i, false);
   return res;
 }
 
@@ -138,17 +529,9 @@ void Solver::Display() {
 }
 
 void Solver::Activate() {
-  for (auto i : grid_.board_) {
-    for (auto j : i)
-      j->is_path_occupied_ = false;
-  }
+  grid_.ClearPath();
   for (auto i : solution_)
-    grid_.board_[i.first][i.second]->is_path_occupied_ = true;
+    grid_.SetOccupied(i, true);
 }
 
-void Solver::Deactivate() {
-  for (auto i : grid_.board_) {
-    for (auto j : i)
-      j->is_path_occupied_ = false;
-  }
-}
+void Solver::Deactivate() { grid_.ClearPath(); }
@@ -0,0 +1,99 @@
+#include "threadpool.h"
+
+namespace {
+// The calling thread's pool, if it is a worker, and its index there.
+thread_local const ThreadPool *owner = nullptr;
+thread_local int worker_index = -1;
+}
+
+ThreadPool::ThreadPool(int threads)
+    : pending_(0), queued_(0), next_(0), stop_(false) {
+  if (threads < 1)
+    threads = 1;
+  for (int i = 0; i < threads; i++)
+    queues_.push_back(std::make_unique<Queue>());
+  for (int i = 0; i < threads; i++)
+    workers_.emplace_back(&ThreadPool::Run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &t : workers_)
+    t.join();
+}
+
+int ThreadPool::WorkerIndex() { return worker_index; }
+
+void ThreadPool::Submit(std::function<void()> task) {
+  // A worker keeps its own tasks, unless it submits to another pool.
+  int index = worker_index;
+  if (owner != this)
+    index = next_.fetch_add(1) % queues_.size();
+
+  pending_++;
+  {
+    std::lock_guard<std::mutex> guard(queues_[index]->lock);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    // Taking lock_ orders this with a worker that just found nothing and is
+    // about to sleep, so the wakeup cannot be missed.
+    std::lock_guard<std::mutex> guard(lock_);
+    queued_++;
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> guard(lock_);
+  idle_.wait(guard, [this] { return pending_ == 0; });
+}
+
+bool ThreadPool::Take(int index, std::function<void()> &task) {
+  {
+    Queue &own = *queues_[index];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  int n = queues_.size();
+  for (int i = 1; i < n; i++) {
+    Queue &other = *queues_[(index + i) % n];
+    std::lock_guard<std::mutex> guard(other.lock);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Run(int index) {
+  owner = this;
+  worker_index = index;
+  std::function<void()> task;
+  while (true) {
+    if (Take(index, task)) {
+      queued_--;
+      task();
+      task = nullptr;
+      if (--pending_ == 0) {
+        std::lock_guard<std::mutex> guard(lock_);
+        idle_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(lock_);
+    wake_.wait(guard, [this] { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0)
+      return;
+  }
+}
@@ -0,0 +1,160 @@
+#include "tilecache.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+void Append(string &key, int x) { key.append((const char *)&x, sizeof x); }
+
+pair<int, int> Turn(pair<int, int> p, int r) {
+  for (int i = 0; i < r; i++)
+    p = {-1 * p.second, p.first}; // as BlockGroup::rotate(1)
+  return p;
+}
+
+// The cells turned r quarter turns and moved to (0, 0): the size of their
+// bounding box, then a bitmap over it.
+string Shape(const set<pair<int, int>> &cells, int r) {
+  int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+  for (auto c : cells) {
+    pair<int, int> p = Turn(c, r);
+    x0 = std::min(x0, p.first);
+    y0 = std::min(y0, p.second);
+    x1 = std::max(x1, p.first);
+    y1 = std::max(y1, p.second);
+  }
+  int w = x1 - x0 + 1, h = y1 - y0 + 1;
+  string res;
+  Append(res, w);
+  Append(res, h);
+  size_t at = res.size();
+  res.resize(at + (w * h + 7) / 8, 0);
+  for (auto c : cells) {
+    pair<int, int> p = Turn(c, r);
+    int k = (p.first - x0) * h + p.second - y0;
+    res[at + k / 8] |= 1 << (k % 8);
+  }
+  return res;
+}
+
+// The smallest Shape of the first turns rotations.
+string Shapes(const set<pair<int, int>> &cells, int turns) {
+  string best = Shape(cells, 0);
+  for (int r = 1; r < turns; r++)
+    best = std::min(best, Shape(cells, r));
+  return best;
+}
+
+// A piece that may rotate is keyed by its smallest rotation, as a bitmap over
+// an 8x8 box when it fits in one (every piece the game makes does).
+string PieceKey(BlockGroup &piece) {
+  string key(1, (char)(piece.oriented * 2 + piece.sub));
+  int turns = piece.oriented ? 1 : 4;
+  int x0[4] = {INT_MAX, INT_MAX, INT_MAX, INT_MAX};
+  int y0[4] = {INT_MAX, INT_MAX, INT_MAX, INT_MAX};
+  for (auto &c : piece.pairs) {
+    for (int r = 0; r < turns; r++) {
+      pair<int, int> p = Turn(c, r);
+      x0[r] = std::min(x0[r], p.first);
+      y0[r] = std::min(y0[r], p.second);
+    }
+  }
+  uint64_t bits[4] = {0, 0, 0, 0};
+  for (auto &c : piece.pairs) {
+    for (int r = 0; r < turns; r++) {
+      pair<int, int> p = Turn(c, r);
+      int x = p.first - x0[r], y = p.second - y0[r];
+      if (x >= 8 || y >= 8)
+        return key + Shapes(piece.pairs, turns);
+      bits[r] |= uint64_t(1) << (x * 8 + y);
+    }
+  }
+  uint64_t best = *std::min_element(bits, bits + turns);
+  key.append((const char *)&best, sizeof best);
+  return key;
+}
+
+} // namespace
+
+TileCache::TileCache(size_t capacity)
+    : capacity_(capacity), hits_(0), misses_(0) {}
+
+string TileCache::Key(BlockGroup &region, vector<BlockGroup> &pieces) {
+  vector<string> keys;
+  for (auto &piece : pieces)
+    keys.push_back(PieceKey(piece));
+  std::sort(keys.begin(), keys.end());
+
+  // The region as a bitmap over its bounding box.
+  int w = region.boundingbox.first, h = region.boundingbox.second;
+  string key;
+  Append(key, w);
+  Append(key, h);
+  size_t at = key.size();
+  key.resize(at + (w * h + 7) / 8, 0);
+  for (auto &p : region.pairs) {
+    int k = (p.first - region.bottomleft.first) * h + p.second -
+            region.bottomleft.second;
+    key[at + k / 8] |= 1 << (k % 8);
+  }
+
+  for (auto &k : keys) {
+    Append(key, (int)k.size());
+    key += k;
+  }
+  return key;
+}
+
+bool TileCache::Solve(BlockGroup &region, vector<BlockGroup> &pieces,
+                      Tiler tiler) {
+  string key = Key(region, pieces);
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      hits_++;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+    misses_++;
+  }
+
+  // Solved outside the lock. Two threads missing on the same key both solve
+  // it, and the second finds the first's entry below.
+  bool res = region.solve(pieces, tiler);
+
+  std::lock_guard<std::mutex> guard(lock_);
+  if (index_.find(key) != index_.end() || capacity_ == 0)
+    return res;
+  entries_.push_front({key, res});
+  index_[key] = entries_.begin();
+  if (entries_.size() > capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  return res;
+}
+
+long long TileCache::Hits() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return hits_;
+}
+
+long long TileCache::Misses() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return misses_;
+}
+
+size_t TileCache::Size() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return entries_.size();
+}
+
+void TileCache::Clear() {
+  std::lock_guard<std::mutex> guard(lock_);
+  entries_.clear();
+  index_.clear();
+  hits_ = 0;
+  misses_ = 0;
+}
@@ -4,6 +4,7 @@
 #include <memory>
 #include <raylib.h>
 
+#include "puzzlequeue.h"
 #include "raylibutils.h"
 #include "witnessclone.h"
 
@@ -46,6 +47,10 @@ Color LITLINE = WHITE;
 Solver sx;
 RandGrid randomgrid;
 
+// Panels made in the background, so dealing the next one does not stall a
+// frame. Created in main, randomgrid covers for it when a family runs dry.
+std::unique_ptr<PuzzleQueue> PREGEN;
+
 Grid thegrid;
 
 // Game state
@@ -135,12 +140,30 @@ inline void drawEndPoint(int x, int y, Grid g, std::pair<double, double> POS,
            THICKNESS, path);
 }
 
-inline void pickgrid() {
-  thegrid = randomgrid.randMaze();
-  const int NUM_PUZ = 8;
+inline bool familyEnabled(PuzzleFamily f) {
+  switch (f) {
+  case kChallengeBlocks:
+    return P_BLOCK;
+  case kBlobs3:
+    return P_BLOB3;
+  case kChallengeStars:
+    return P_STARDOT;
+  case kTriangles:
+    return P_TRIX;
+  case kBlobs2:
+    return P_BLOB2;
+  case kDots:
+    return P_DOT;
+  case kStars:
+    return P_STAR;
+  default:
+    return P_MAZE;
+  }
+}
 
+inline void pickgrid() {
   std::vector<int> shuffle;
-  for (int i = 0; i < NUM_PUZ; i++) {
+  for (int i = 0; i < kPuzzleFamilies; i++) {
     shuffle.push_back(i);
   }
 
@@ -148,32 +171,15 @@ inline void pickgrid() {
   std::mt19937 g(rd());
   std::shuffle(shuffle.begin(), shuffle.end(), g);
 
-  int index = 0;
-  while (index < shuffle.size()) {
-    int decisionmaking = shuffle[index];
-    if (decisionmaking == 0 && P_BLOCK)
-      thegrid = randomgrid.randChallengeBlocks(2);
-    else if (decisionmaking == 1 && P_BLOB3)
-      thegrid = randomgrid.randBlobs(9, 3, 2);
-    else if (decisionmaking == 2 && P_STARDOT)
-      thegrid = randomgrid.randChallengeStars(2);
-    else if (decisionmaking == 3 && P_TRIX)
-      thegrid = randomgrid.randTriangles(10, 2);
-    else if (decisionmaking == 4 && P_BLOB2)
-      thegrid = randomgrid.randBlobs(8, 2, 4);
-    else if (decisionmaking == 5 && P_DOT)
-      thegrid = randomgrid.randDots(4, 2);
-    else if (decisionmaking == 6 && P_STAR)
-      thegrid = randomgrid.randStars();
-    else if (decisionmaking == 7 && P_MAZE)
-      thegrid = randomgrid.randMaze();
-    else {
-      index++;
+  for (int i : shuffle) {
+    PuzzleFamily f = (PuzzleFamily)i;
+    if (!familyEnabled(f))
       continue;
-    }
-
-    break;
+    if (!PREGEN->TryPop(f, thegrid))
+      thegrid = randomgrid.randFamily(f);
+    return;
   }
+  thegrid = randomgrid.randMaze();
 }
 
 void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
@@ -247,14 +253,14 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
                                   GRIDTL.second + halfspacing * y};
       if (x % 2 != 0 && y % 2 != 0)
         continue;
-      std::shared_ptr<Entity> entity = (g.board_)[y][x];
-      if (!(entity->is_path_))
+      SymbolKind kind = g.KindAt({y, x});
+      if (!g.IsPath({y, x}))
         DrawRectangle(POS.first - GAPPROP * halfspacing,
                       POS.second - GAPPROP * halfspacing, GAPPROP * SPACING,
                       GAPPROP * SPACING, BG);
-      if (isStartingPoint(entity))
+      if (kind == SymbolKind::kStart)
         DrawCircle(POS.first, POS.second, THICKNESS * START_RAD, PATH);
-      else if (isEndingPoint(entity)) {
+      else if (kind == SymbolKind::kEnd) {
         // cout << "ENDPOINT FOUND" << x << " " << y << "\n";
         PRODIST = PROTRUSION * SPACING;
         drawEndPoint(x, y, g, POS, PRODIST, PATH);
@@ -268,10 +274,12 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
     for (int x = 0; x < g.m_; x++) {
       pair<double, double> POS = {GRIDTL.first + halfspacing * x,
                                   GRIDTL.second + halfspacing * y};
-      std::shared_ptr<Entity> e = g.board_[y][x];
-      if (instanceof<Dot>(e))
+      const std::shared_ptr<Entity> &e = g.board_[y][x];
+      switch (e->kind_) {
+      case SymbolKind::kDot:
         DrawPoly(vec2pd(POS), 6, THICKNESS * 0.8, 0, DOT);
-      if (instanceof<Blob>(e)) {
+        break;
+      case SymbolKind::kBlob: {
         const double OBJ_SIZE = 0.8;
         double obj_width = OBJ_SIZE * halfspacing * GAPPROP;
         Rectangle rect = {static_cast<float>(POS.first - obj_width),
@@ -279,15 +287,17 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
                           static_cast<float>(2 * obj_width),
                           static_cast<float>(2 * obj_width)};
         DrawRectangleRounded(rect, 0.5, 8, getColor(e->color_));
+        break;
       }
-      if (instanceof<Star>(e)) {
+      case SymbolKind::kStar: {
         const double OBJ_SIZE = 00.8;
         double obj_width = OBJ_SIZE * halfspacing * GAPPROP;
         DrawPoly(vec2pd(POS), 4, obj_width, 0, getColor(e->color_));
         DrawPoly(vec2pd(POS), 4, obj_width, 45, getColor(e->color_));
+        break;
       }
-      if (instanceof<Triangle>(e)) {
-        int count = (std::dynamic_pointer_cast<Triangle>(e))->x_;
+      case SymbolKind::kTriangle: {
+        int count = symbol_cast<Triangle>(e)->x_;
         const double OBJ_SIZE = 0.2;
         const double OBJ_SPAC = 0.2;
 
@@ -296,8 +306,9 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
         for (int i = 0; i < count; i++)
           DrawPoly(vec2pd({leftmost + SPACING * OBJ_SPAC * i, POS.second}), 3,
                    OBJ_SIZE * SPACING * 0.5, -90, getColor(e->color_));
+        break;
       }
-      if (instanceof<Cancel>(e)) {
+      case SymbolKind::kCancel: {
         const double OBJ_SIZE = 0.2;
         const double OBJ_THICK = 0.05;
 
@@ -310,12 +321,12 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
         DrawRotatedRect(
             POS.first, POS.second, POS.first + sqrt(0.75) * OBJ_SIZE * SPACING,
             POS.second + 0.5 * OBJ_SIZE * SPACING, OBJ_THICK * SPACING, WHITE);
+        break;
       }
-      if (instanceof<BlockGroup>(e)) {
+      case SymbolKind::kBlock: {
         // std::cout << "BLOCK GROUP LOCATED AT POSITION " << POS.first << " "
         // << POS.second << std::endl;
-        std::shared_ptr<BlockGroup> bg =
-            std::dynamic_pointer_cast<BlockGroup>(e);
+        BlockGroup *bg = symbol_cast<BlockGroup>(e);
         // std::cout << "BLOCK GROUP AT INDEX " << x << " " << y << " ORIENTED?
         // " << bg->oriented << "\n";
         bg->normalize();
@@ -341,6 +352,10 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
                      45 + ROTATION * RAD2DEG, getColor(e->color_));
           }
         }
+        break;
+      }
+      default:
+        break;
       }
     }
   }
@@ -351,9 +366,7 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
     for (int x = 0; x < g.m_; x++) {
       pair<double, double> POS = {GRIDTL.first + halfspacing * x,
                                   GRIDTL.second + halfspacing * y};
-      std::shared_ptr<Entity> e = g.board_[y][x];
-
-      if (e->is_path_occupied_) {
+      if (g.IsOccupied({y, x})) {
         if (x % 2 == 0 && y % 2 == 0)
           DrawCircle(POS.first, POS.second, THICKNESS, LINE);
         else if (x % 2 == 0)
@@ -363,9 +376,10 @@ void Render(Grid &g, const int width, const int height, double marginprop = 0.1,
           DrawRectangle(POS.first - halfspacing, POS.second - THICKNESS,
                         SPACING, THICKNESS * 2, LINE);
 
-        if (isStartingPoint(e))
+        SymbolKind kind = g.KindAt({y, x});
+        if (kind == SymbolKind::kStart)
           DrawCircle(POS.first, POS.second, THICKNESS * START_RAD, LINE);
-        else if (isEndingPoint(e)) {
+        else if (kind == SymbolKind::kEnd) {
 
           PRODIST = PROTRUSION * SPACING;
           drawEndPoint(x, y, g, POS, PRODIST, LINE);
@@ -428,6 +442,8 @@ inline void toggleSettings(int x) {
     P_MAZE = !P_MAZE; // Random maze
   if (x == 7)
     P_STAR = !P_STAR; // Random 4 stars
+  for (int f = 0; f < kPuzzleFamilies; f++)
+    PREGEN->Enable((PuzzleFamily)f, familyEnabled((PuzzleFamily)f));
 }
 
 inline const char *onoff(bool b) { return (b ? "ON" : "OFF"); }
@@ -483,12 +499,12 @@ inline void DoSettings() {
 int main() {
   srand(time(0));
 
-  randomgrid.pathfind();
-
   SetTraceLogLevel(LOG_WARNING);
   InitWindow(kScreenWidth, kScreenHeight, "game");
   SetTargetFPS(60);
 
+  PREGEN = std::make_unique<PuzzleQueue>();
+
   while (!WindowShouldClose()) {
     BeginDrawing();
 
@@ -549,7 +565,7 @@ int main() {
 
       for (int r = 0; r < thegrid.m_; r++) {
         for (int c = 0; c < thegrid.n_; c++) {
-          if (!isEndingPoint(thegrid.board_[r][c]))
+          if (thegrid.KindAt({r, c}) != SymbolKind::kEnd)
             continue;
           Vector2 v = endpointdisplacement(thegrid, r, c);
           Vector2 endpointpos = vec2fromindex({r, c});
@@ -625,7 +641,7 @@ int main() {
         bool dreamscometrue = false;
 
         if (closestrank >= 0 && closestfile >= 0 &&
-            isEndingPoint(thegrid.board_[closestrank][closestfile])) {
+            thegrid.KindAt({closestrank, closestfile}) == SymbolKind::kEnd) {
           Vector2 v = endpointdisplacement(thegrid, closestrank, closestfile);
           Vector2 endpointpos = vec2fromindex({closestrank, closestfile});
           Vector2 endpointend = {endpointpos.x + v.x, endpointpos.y + v.y};
@@ -671,7 +687,7 @@ int main() {
           // Cut test
           for (int r = 0; r < thegrid.n_; r++) {
             for (int f = 0; f < thegrid.m_; f++) {
-              if (thegrid.board_[r][f]->is_path_)
+              if (thegrid.IsPath({r, f}))
                 continue;
               thevec = vec2fromindex({r, f});
 
@@ -702,7 +718,7 @@ int main() {
           // Cut test
           for (int r = 0; r < thegrid.n_; r++) {
             for (int f = 0; f < thegrid.m_; f++) {
-              if (thegrid.board_[r][f]->is_path_)
+              if (thegrid.IsPath({r, f}))
                 continue;
               thevec = vec2fromindex({r, f});
               bool dirreq = (md.y > 0 && thevec.y > newcurspos.y) ||
@@ -842,10 +858,7 @@ int main() {
       disp(mp);
       disp(pdvec2(md));
 
-      for (int i = 0; i < thegrid.n_; i++) {
-        for (int j = 0; j < thegrid.m_; j++)
-          thegrid.board_[i][j]->is_path_occupied_ = false;
-      }
+      thegrid.ClearPath();
 
       for (auto i : thegrid.starts_) {
         std::cout << "START! ";
@@ -854,7 +867,7 @@ int main() {
         if (rsqpd(mp, posfromindex(i)) <=
             THICKNESS * START_RAD * THICKNESS * START_RAD) {
           startpos = {i.first, i.second};
-          thegrid.board_[i.first][i.second]->is_path_occupied_ = true;
+          thegrid.SetOccupied(i, true);
           cursorpos = vec2fromindex(i);
           LOCKEDIN = true;
           while (pathpos.size() > 0)
@@ -879,11 +892,11 @@ int main() {
       for (auto i : pathpos) {
         for (int r = 0; r < thegrid.n_; r++) {
           for (int f = 0; f < thegrid.m_; f++) {
-            if (!thegrid.board_[r][f]->is_path_)
+            if (!thegrid.IsPath({r, f}))
               continue;
             Vector2 v = vec2fromindex({r, f});
             if (rsqvec2(i, v) <= CHECK_THRESHOLD * CHECK_THRESHOLD)
-              thegrid.board_[r][f]->is_path_occupied_ = true;
+              thegrid.SetOccupied({r, f}, true);
           }
         }
       }
@@ -900,10 +913,7 @@ int main() {
       LOCKEDIN = false;
       EnableCursor();
 
-      for (int i = 0; i < thegrid.n_; i++) {
-        for (int j = 0; j < thegrid.m_; j++)
-          thegrid.board_[i][j]->is_path_occupied_ = false;
-      }
+      thegrid.ClearPath();
 
       if (SOLVED || RESET) {
         std::cout << "SOLVED PUZZLE" << std::endl;
@@ -956,6 +966,7 @@ int main() {
               sx.Set(thegrid);
               sx.Solve();
               sx.Activate();
+              thegrid = sx.grid_;
               RESET = true;
             } else {
               sx.Deactivate();
@@ -981,6 +992,7 @@ int main() {
             sx.Set(thegrid);
             sx.Solve();
             sx.Activate();
+            thegrid = sx.grid_;
           }
         }
       }
@@ -989,6 +1001,7 @@ int main() {
     EndDrawing();
   }
 
+  PREGEN.reset();
   CloseWindow();
   return 0;
 }
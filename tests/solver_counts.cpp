@@ -0,0 +1,178 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "blockgroup.h"
+#include "grid.h"
+#include "solver.h"
+#include "util.h"
+
+// Solver::CountSolutions against a brute force count: every simple line from
+// a start to an end, checked with Grid::IsValid. The prunes may only cut
+// lines that fail, so the two counts must agree on every panel. Small random
+// panels of the layouts no generator makes but text files may hold.
+
+using std::vector;
+
+namespace {
+
+// How many of each symbol a panel gets. Dots go on lattice points and
+// edges, cuts on edges, the rest on symbol cells.
+struct Layout {
+  const char *name;
+  int rows, cols; // panel cells
+  int triangles, dots, blobs, stars, blocks, cancels, cuts;
+  bool edgeends;  // ends on edge cells instead of lattice points
+};
+
+// Lines from the last cell drawn, each stopping at the first end point.
+long long Brute(Grid &g, pair<int, int> start, pair<int, int> p) {
+  const int dx[4] = {1, 0, -1, 0};
+  const int dy[4] = {0, 1, 0, -1};
+  if (g.KindAt(p) == SymbolKind::kEnd)
+    return g.IsValid(start.first, start.second);
+  long long res = 0;
+  for (int d = 0; d < 4; d++) {
+    pair<int, int> q = {p.first + dx[d], p.second + dy[d]};
+    if (!g.Inside(q) || !g.IsPath(q) || g.IsOccupied(q))
+      continue;
+    g.SetOccupied(q, true);
+    res += Brute(g, start, q);
+    g.SetOccupied(q, false);
+  }
+  return res;
+}
+
+long long Brute(Grid g) {
+  long long res = 0;
+  for (auto s : g.starts_) {
+    g.ClearPath();
+    g.SetOccupied(s, true);
+    res += Brute(g, s, s);
+  }
+  return res;
+}
+
+Grid RandomPanel(const Layout &l, std::mt19937 &rng) {
+  int m = 2 * l.rows + 1, n = 2 * l.cols + 1;
+  auto pick = [&](int k) { return (int)(rng() % k); };
+  vector<vector<std::shared_ptr<Entity>>> v(
+      m, vector<std::shared_ptr<Entity>>(n));
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      v[i][j] = std::make_shared<Entity>();
+      v[i][j]->is_path_ = i % 2 == 0 || j % 2 == 0;
+    }
+  }
+
+  auto place = [&](SymbolKind k, pair<int, int> p, int arg) {
+    bool path = v[p.first][p.second]->is_path_;
+    v[p.first][p.second] = make_symbol(k, kPalette[1], arg);
+    v[p.first][p.second]->is_path_ = path;
+  };
+  auto empty = [&](pair<int, int> p) {
+    return v[p.first][p.second]->kind_ == SymbolKind::kNone;
+  };
+
+  pair<int, int> start = {2 * pick(l.rows + 1), 2 * pick(l.cols + 1)};
+  place(SymbolKind::kStart, start, 0);
+  while (true) {
+    pair<int, int> end;
+    if (l.edgeends) {
+      end = {pick(m), pick(n)};
+      if ((end.first + end.second) % 2 == 0)
+        continue;
+    } else {
+      end = {2 * pick(l.rows + 1), 2 * pick(l.cols + 1)};
+    }
+    if (!empty(end))
+      continue;
+    place(SymbolKind::kEnd, end, 0);
+    break;
+  }
+  auto symbolcell = [&]() {
+    while (true) {
+      pair<int, int> p = {1 + 2 * pick(l.rows), 1 + 2 * pick(l.cols)};
+      if (empty(p))
+        return p;
+    }
+  };
+  auto linecell = [&]() {
+    while (true) {
+      pair<int, int> p = {pick(m), pick(n)};
+      if (v[p.first][p.second]->is_path_ && empty(p))
+        return p;
+    }
+  };
+
+  for (int k = 0; k < l.triangles; k++)
+    place(SymbolKind::kTriangle, symbolcell(), 1 + pick(3));
+  auto colored = [&](SymbolKind k) { // in one of two colors
+    pair<int, int> p = symbolcell();
+    v[p.first][p.second] = make_symbol(k, kPalette[1 + pick(2)], 0);
+  };
+  for (int k = 0; k < l.blobs; k++)
+    colored(SymbolKind::kBlob);
+  for (int k = 0; k < l.stars; k++)
+    colored(SymbolKind::kStar);
+  for (int k = 0; k < l.blocks; k++) {
+    pair<int, int> p = symbolcell();
+    vector<pair<int, int>> squares = {{0, 0}};
+    if (pick(2))
+      squares.push_back(pick(2) ? std::make_pair(1, 0) : std::make_pair(0, 1));
+    v[p.first][p.second] =
+        std::make_shared<BlockGroup>(pick(2), false, squares, kPalette[4]);
+  }
+  for (int k = 0; k < l.cancels; k++)
+    place(SymbolKind::kCancel, symbolcell(), 0);
+  for (int k = 0; k < l.dots; k++)
+    place(SymbolKind::kDot, linecell(), 0);
+  for (int k = 0; k < l.cuts; k++) {
+    pair<int, int> p = linecell();
+    if ((p.first + p.second) % 2 == 1)
+      v[p.first][p.second]->is_path_ = false;
+  }
+  return Grid(v);
+}
+
+} // namespace
+
+int main() {
+  //                                 tri dot blob star block cancel cut
+  const Layout layouts[] = {
+      {"2x2 triangles, cancel", 2, 2, 2, 0, 0, 0, 0, 1, 0, false},
+      {"2x3 triangles, cancel", 2, 3, 3, 0, 0, 0, 0, 1, 0, false},
+      {"3x3 triangles", 3, 3, 4, 0, 0, 0, 0, 0, 0, false},
+      {"2x3 triangles, edge end", 2, 3, 3, 0, 0, 0, 0, 0, 0, true},
+      {"3x3 triangles, edge end", 3, 3, 5, 0, 0, 0, 0, 0, 0, true},
+      {"2x3 dots, cancel", 2, 3, 0, 3, 0, 0, 0, 1, 0, false},
+      {"3x3 dots, cuts", 3, 3, 0, 4, 0, 0, 0, 0, 2, false},
+      {"2x3 blobs, edge end", 2, 3, 0, 0, 4, 0, 0, 0, 0, true},
+      {"2x3 stars, edge end", 2, 3, 0, 0, 0, 4, 0, 0, 0, true},
+      {"2x3 blocks, edge end", 2, 3, 0, 0, 0, 0, 2, 0, 0, true},
+      {"3x3 blobs, cuts", 3, 3, 0, 0, 5, 0, 0, 0, 2, false},
+  };
+  const int kPanels = 500;
+
+  std::mt19937 rng(1);
+  int failed = 0;
+  for (const Layout &l : layouts) {
+    int wrong = 0;
+    for (int i = 0; i < kPanels; i++) {
+      Grid g = RandomPanel(l, rng);
+      long long want = Brute(g);
+      Solver s(g);
+      s.seed_ = 1;
+      long long got = s.CountSolutions(0);
+      if (got != want) {
+        if (wrong++ == 0)
+          printf("%s: %lld solutions, solver counts %lld\n%s\n", l.name, want,
+                 got, g.ToString().c_str());
+      }
+    }
+    printf("%-26s %d/%d wrong\n", l.name, wrong, kPanels);
+    failed += wrong;
+  }
+  return failed > 0 ? 1 : 0;
+}